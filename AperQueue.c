@@ -0,0 +1,124 @@
+#include "AperQueue.h"
+#include "Profiler.h"
+#include "Atomic.h"
+
+#include <stddef.h>
+
+#define QUEUE_MASK (SCHED_MAX_APERIODIC - 1)
+
+void aperQueue_init(AperQueue* q) {
+    uint32_t i;
+    for (i = 0; i < SCHED_MAX_APERIODIC; i++) q->slots[i].sequence = i;
+    q->head = 0;
+    q->tail = 0;
+    q->heapCount = 0;
+    q->highWater = 0;
+}
+
+bool aperQueue_post(AperQueue* q, void (*function)(taskFuncFlag_t* flags), uint32_t compTime,
+                    bool hasDeadline, uint32_t deadline, uint8_t priority, uint32_t postedAt) {
+    uint32_t pos = q->head;
+    AperSlot* slot;
+
+    while (1) {
+        slot = &(q->slots[pos & QUEUE_MASK]);
+        int32_t diff = (int32_t)(slot->sequence - pos);
+
+        if (diff == 0) {
+            //slot is free for this position, try to claim it
+            if (atomic_compareAndSwap(&q->head, pos, pos + 1)) break;
+            pos = q->head;
+        }
+        else if (diff < 0) {
+            return false; //the consumer has not freed this slot yet, the queue is full
+        }
+        else {
+            pos = q->head; //another producer got here first
+        }
+    }
+
+    slot->job.function = function;
+    slot->job.compTime = compTime;
+    slot->job.remainingCompTime = compTime;
+    slot->job.deadline = deadline;
+    slot->job.hasDeadline = hasDeadline;
+    slot->job.priority = priority;
+    slot->job.sequence = pos;
+#if SCHED_PROFILE
+    profile_release(&(slot->job.profile), postedAt);
+#else
+    (void)postedAt; //only used to profile the job
+#endif
+
+    //the job has to be visible before the consumer sees the new sequence
+    ATOMIC_BARRIER();
+    slot->sequence = pos + 1;
+    return true;
+}
+
+//true if a should be served before b. times are compared as differences so they may wrap
+static bool moreUrgent(const AperJob* a, const AperJob* b) {
+    if (a->hasDeadline != b->hasDeadline) return a->hasDeadline;
+    if (a->hasDeadline && a->deadline != b->deadline) return (int32_t)(a->deadline - b->deadline) < 0;
+    if (a->priority != b->priority) return a->priority > b->priority;
+    return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+static void heapPush(AperQueue* q, const AperJob* job) {
+    uint32_t i = q->heapCount++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!moreUrgent(job, &(q->heap[parent]))) break;
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = *job;
+}
+
+static void heapPop(AperQueue* q) {
+    AperJob last = q->heap[--q->heapCount];
+    uint32_t i = 0;
+    while (1) {
+        uint32_t child = 2 * i + 1;
+        if (child >= q->heapCount) break;
+        if (child + 1 < q->heapCount && moreUrgent(&(q->heap[child + 1]), &(q->heap[child]))) child++;
+        if (!moreUrgent(&(q->heap[child]), &last)) break;
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    q->heap[i] = last;
+}
+
+//moves every published job from the ring into the heap while there is room
+static void drain(AperQueue* q) {
+    while (q->heapCount < SCHED_MAX_APERIODIC) {
+        AperSlot* slot = &(q->slots[q->tail & QUEUE_MASK]);
+        if (slot->sequence != q->tail + 1) break;
+        ATOMIC_BARRIER();
+
+        heapPush(q, &(slot->job));
+
+        //finish with the job before handing the slot back to the producers
+        ATOMIC_BARRIER();
+        slot->sequence = q->tail + SCHED_MAX_APERIODIC;
+        q->tail++;
+    }
+}
+
+AperJob* aperQueue_peek(AperQueue* q) {
+    drain(q);
+    if (!q->heapCount) return NULL;
+
+    uint32_t queued = aperQueue_count(q);
+    if (queued > q->highWater) q->highWater = queued;
+
+    return &(q->heap[0]);
+}
+
+void aperQueue_pop(AperQueue* q) {
+    if (q->heapCount) heapPop(q);
+}
+
+uint32_t aperQueue_count(const AperQueue* q) {
+    return q->heapCount + (q->head - q->tail);
+}
@@ -0,0 +1,70 @@
+/*
+ * AperQueue.h
+ *
+ *  bounded queue of aperiodic jobs, served most urgent first. any number of producers, including ISRs,
+ *  can post in constant time without disabling interrupts. a single consumer, the aperiodic server, drains it.
+ *  producers claim a slot of a lock-free ring with a compare-and-swap on head (LDREX/STREX on the Cortex-M4)
+ *  and publish it through a per-slot sequence number, so a producer interrupted half way through never
+ *  blocks another. the consumer moves published jobs from the ring into a binary heap ordered by deadline,
+ *  then priority, then posting order, so a long job no longer holds up short urgent ones queued behind it
+ */
+#ifndef APERQUEUE_H_
+#define APERQUEUE_H_
+
+#include "Scheduler.h"
+
+#if (SCHED_MAX_APERIODIC & (SCHED_MAX_APERIODIC - 1)) != 0
+#error "SCHED_MAX_APERIODIC must be a power of two"
+#endif
+
+//an aperiodic job and the keys it is served by. stored by value so posting never allocates
+//only what the server needs to run it is kept, the job runs through a Task shared by every aperiodic job
+typedef struct {
+    void (*function)(taskFuncFlag_t* flags);
+    uint32_t compTime;
+    uint32_t remainingCompTime;
+    uint32_t deadline; //absolute, a timer_getMicros() time. only meaningful if hasDeadline is set
+    bool hasDeadline; //jobs with a deadline are served before jobs without one
+    uint8_t priority; //among equal deadlines, or no deadlines, higher priority is served first
+    uint32_t sequence; //ring position the job was posted at, breaks the remaining ties oldest first
+#if SCHED_PROFILE
+    JobProfile profile; //adds to the TaskStats shared by every aperiodic job, see sched_aperiodicStats()
+#endif
+} AperJob;
+
+typedef struct {
+    volatile uint32_t sequence; //position this slot is ready for. pos + 1 once published, pos + size once consumed
+    AperJob job;
+} AperSlot;
+
+typedef struct {
+    AperSlot slots[SCHED_MAX_APERIODIC]; //ring the producers post into
+    volatile uint32_t head; //next position a producer claims
+    uint32_t tail; //next position the consumer reads, only touched by the consumer
+    AperJob heap[SCHED_MAX_APERIODIC]; //jobs taken off the ring, most urgent at heap[0]. consumer only
+    uint32_t heapCount;
+    uint32_t highWater; //most jobs seen queued at once, measured by the consumer
+} AperQueue;
+
+//empties the queue. not safe while producers are running
+void aperQueue_init(AperQueue* q);
+
+//queues a job. deadline is absolute and ignored unless hasDeadline is set
+//postedAt is the timer_getMicros() time of the post, the job's release for profiling
+//safe to call from any context, including ISRs
+//returns false if the ring is full, which happens once SCHED_MAX_APERIODIC jobs are waiting to be taken off it
+bool aperQueue_post(AperQueue* q, void (*function)(taskFuncFlag_t* flags), uint32_t compTime,
+                    bool hasDeadline, uint32_t deadline, uint8_t priority, uint32_t postedAt);
+
+//returns the most urgent job, or NULL if the queue is empty. consumer only
+//the job stays in the queue and can be updated in place until the next call to aperQueue_peek() or aperQueue_pop()
+//a more urgent job posted in the meantime takes its place at the next peek, the old one keeps its progress
+AperJob* aperQueue_peek(AperQueue* q);
+
+//removes the job returned by the last aperQueue_peek(). consumer only
+void aperQueue_pop(AperQueue* q);
+
+//number of jobs queued or being posted
+uint32_t aperQueue_count(const AperQueue* q);
+
+#endif /* APERQUEUE_H_ */
@@ -0,0 +1,39 @@
+/*
+ * Atomic.h
+ *
+ *  the few atomic operations the lock-free queues need. exclusive load/store (LDREX/STREX) on the
+ *  Cortex-M4, gcc __atomic builtins on the host
+ */
+#ifndef ATOMIC_H_
+#define ATOMIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__TI_ARM__)
+//exclusive load/store. any exception entry or return clears the exclusive monitor,
+//so an ISR that writes between the two makes the interrupted STREX fail and retry
+static inline bool atomic_compareAndSwap(volatile uint32_t* p, uint32_t expected, uint32_t desired) {
+    if (__ldrex((void*)p) != expected) {
+        __clrex();
+        return false;
+    }
+    return __strex(desired, (void*)p) == 0;
+}
+#define ATOMIC_BARRIER() __asm(" dmb")
+#else
+static inline bool atomic_compareAndSwap(volatile uint32_t* p, uint32_t expected, uint32_t desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+#define ATOMIC_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+//adds one to *p, safe against any other context doing the same
+static inline void atomic_increment(volatile uint32_t* p) {
+    uint32_t value;
+    do {
+        value = *p;
+    } while (!atomic_compareAndSwap(p, value, value + 1));
+}
+
+#endif /* ATOMIC_H_ */
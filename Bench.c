@@ -0,0 +1,397 @@
+#include "Bench.h"
+
+//built into a program only when SCHED_BENCH is defined, so it can stay in the project
+#ifdef SCHED_BENCH
+
+#include "Utils.h"
+#include "AperQueue.h"
+#include "testTasks.h"
+#include "Timer.h"
+
+#include <stdio.h>
+
+#ifndef SCHED_HOST
+//Cortex-M4 debug registers, tm4c123gh6pm.h does not define them
+#define DEMCR_R (*((volatile uint32_t*)0xE000EDFC))
+#define DWT_CTRL_R (*((volatile uint32_t*)0xE0001000))
+#define DWT_CYCCNT_R (*((volatile uint32_t*)0xE0001004))
+#define DEMCR_TRCENA 0x01000000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+
+#define BENCH_UNIT "cycles"
+
+static void counterInit(void) {
+    DEMCR_R |= DEMCR_TRCENA;
+    DWT_CYCCNT_R = 0;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+}
+
+static uint32_t counterNow(void) {
+    return DWT_CYCCNT_R;
+}
+#else
+#include <time.h>
+
+#define BENCH_UNIT "ns"
+
+static void counterInit(void) {
+}
+
+//wraps every 4 seconds, only differences are used
+static uint32_t counterNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+#endif
+
+#define BENCH_MAX_TASKS 16 //largest task set generated, must fit in SCHED_MAX_TASKS
+#define BENCH_MIN_PERIOD 10 //shortest period generated, in slots
+#define BENCH_ITERATIONS 100 //calls per measurement of the cheap operations
+#define BENCH_RESPONSE_HYPERPERIODS 10
+
+static void (*sink)(const char* line);
+static PeriodicTask benchTasks[BENCH_MAX_TASKS];
+static AperQueue benchQueue; //kept apart from the scheduler's own queue
+static uint32_t randomState;
+
+static void emit(const char* benchmark, const char* variant, uint32_t tasks, uint32_t slots, uint32_t value, const char* unit) {
+    char line[96];
+    sprintf(line, "%s,%s,%lu,%lu,%lu,%s", benchmark, variant, (unsigned long)tasks, (unsigned long)slots,
+            (unsigned long)value, unit);
+    sink(line);
+}
+
+//xorshift32, the same sequence on every run
+static uint32_t benchRandom(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static uint32_t median(uint32_t* samples) {
+    uint8_t i;
+    for (i = 1; i < SCHED_BENCH_REPEATS; i++) {
+        uint32_t value = samples[i];
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1] > value) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+    return samples[SCHED_BENCH_REPEATS / 2];
+}
+
+//fills benchTasks with n tasks whose periods divide the hyperperiod, at roughly 80% utilization
+//periods are the largest divisors of at least BENCH_MIN_PERIOD slots, reused if there are fewer than n,
+//so the first task's period is the hyperperiod itself
+static runFlag_t makeTaskSet(PeriodicTaskSet* ts, uint8_t n, uint32_t hyperperiod, void (*f)(taskFuncFlag_t* flags)) {
+    uint32_t divisors[BENCH_MAX_TASKS];
+    uint8_t count = 0;
+    uint32_t d;
+    for (d = hyperperiod; d >= BENCH_MIN_PERIOD && count < BENCH_MAX_TASKS; d--) {
+        if (hyperperiod % d == 0) divisors[count++] = d;
+    }
+
+    runFlag_t flags = 0;
+    uint8_t i;
+    for (i = 0; i < n; i++) {
+        uint32_t period = divisors[i % count];
+        uint32_t compTime = period * 4 / (5 * n);
+        flags |= fillPeriodicTask(benchTasks + i, f, compTime ? compTime : 1, period);
+    }
+
+    ts->tasks = benchTasks;
+    ts->size = n;
+    return flags;
+}
+
+static void benchHyperperiod(void) {
+    static const uint8_t sizes[] = { 2, 4, 8, 16 };
+    uint8_t s;
+    for (s = 0; s < sizeof(sizes); s++) {
+        PeriodicTaskSet ts;
+        uint32_t samples[SCHED_BENCH_REPEATS];
+        uint32_t lcm = 0;
+        uint8_t r;
+
+        if (!makeTaskSet(&ts, sizes[s], 2520, oneMilliTask)) {
+            for (r = 0; r < SCHED_BENCH_REPEATS; r++) {
+                uint32_t start = counterNow();
+                uint32_t k;
+                for (k = 0; k < BENCH_ITERATIONS; k++) leastCommonMultiple(ts, &lcm);
+                samples[r] = (counterNow() - start) / BENCH_ITERATIONS;
+            }
+            emit("hyperperiod", "-", ts.size, lcm, median(samples), BENCH_UNIT);
+        }
+
+        freePeriodicTaskSet(&ts);
+    }
+}
+
+static void benchBuild(void) {
+    static const uint8_t sizes[] = { 2, 4, 8, 16 };
+    static const uint32_t hyperperiods[] = { 120, 720, 2520 };
+    uint8_t s, h;
+    for (h = 0; h < sizeof(hyperperiods) / sizeof(hyperperiods[0]); h++) {
+        for (s = 0; s < sizeof(sizes); s++) {
+            PeriodicTaskSet ts;
+            uint32_t samples[SCHED_BENCH_REPEATS];
+            runFlag_t error = makeTaskSet(&ts, sizes[s], hyperperiods[h], oneMilliTask);
+            PeriodicSchedule* schedule = NULL;
+            uint8_t r;
+
+            for (r = 0; r < SCHED_BENCH_REPEATS && !error; r++) {
+                invalidateSchedule();
+                uint32_t start = counterNow();
+                schedule = getSchedule(ts, &error);
+                samples[r] = counterNow() - start;
+            }
+
+            if (error) {
+                emit("build_error", "-", ts.size, hyperperiods[h], error, "flags");
+            }
+            else {
+                emit("build_time", "-", ts.size, hyperperiods[h], median(samples), BENCH_UNIT);
+                emit("build_runs", "-", ts.size, hyperperiods[h], schedule->runCount, "runs");
+                emit("build_bytes", "-", ts.size, hyperperiods[h],
+                     sizeof(PeriodicSchedule) + schedule->runCount * sizeof(ScheduleRun), "bytes");
+            }
+
+            invalidateSchedule();
+            freePeriodicTaskSet(&ts);
+        }
+    }
+}
+
+static void benchAperiodic(void) {
+    static const char* variants[] = { "fifo", "deadline" };
+    uint8_t v;
+    for (v = 0; v < 2; v++) {
+        uint32_t postSamples[SCHED_BENCH_REPEATS];
+        uint32_t popSamples[SCHED_BENCH_REPEATS];
+        uint8_t r;
+
+        randomState = 2463534242u;
+        for (r = 0; r < SCHED_BENCH_REPEATS; r++) {
+            uint32_t k;
+            aperQueue_init(&benchQueue);
+
+            //a full queue, then empty it again, so the heap is exercised at every depth
+            uint32_t start = counterNow();
+            for (k = 0; k < SCHED_MAX_APERIODIC; k++) {
+                uint32_t key = benchRandom();
+                aperQueue_post(&benchQueue, oneMilliTask, 1, v == 1, key % 1000, (uint8_t)(key >> 24), 0);
+            }
+            postSamples[r] = (counterNow() - start) / SCHED_MAX_APERIODIC;
+
+            start = counterNow();
+            for (k = 0; k < SCHED_MAX_APERIODIC; k++) {
+                aperQueue_peek(&benchQueue);
+                aperQueue_pop(&benchQueue);
+            }
+            popSamples[r] = (counterNow() - start) / SCHED_MAX_APERIODIC;
+        }
+
+        emit("aper_post", variants[v], SCHED_MAX_APERIODIC, 0, median(postSamples), BENCH_UNIT);
+        emit("aper_pop", variants[v], SCHED_MAX_APERIODIC, 0, median(popSamples), BENCH_UNIT);
+    }
+}
+
+//gaps between one call of dispatchProbe() returning and the next one starting, split by whether a slot ended between them
+typedef struct {
+    uint32_t count;
+    uint64_t total;
+    uint32_t max;
+} Gaps;
+
+static Gaps callGaps;
+static Gaps slotGaps;
+static uint32_t probeExit;
+static bool probeSlotEnded;
+static bool probeStarted;
+
+static void addGap(Gaps* g, uint32_t gap) {
+    g->count++;
+    g->total += gap;
+    if (gap > g->max) g->max = gap;
+}
+
+//task function that spends a quarter slot waiting and measures the scheduler time around it
+//the slot tick almost always lands in the wait, so a call that saw it is the last one of its slot
+static void dispatchProbe(taskFuncFlag_t* flags) {
+    uint32_t enter = counterNow();
+    if (probeStarted) addGap(probeSlotEnded ? &slotGaps : &callGaps, enter - probeExit);
+
+    unsigned int tick = timer_fireCount();
+    timer_waitMicros(SCHED_QUANTUM_US / 4);
+    probeSlotEnded = timer_fireCount() != tick;
+    probeStarted = true;
+
+    *flags |= FLAG_FINISHED;
+    probeExit = counterNow();
+}
+
+static void benchDispatch(void) {
+    static const uint8_t sizes[] = { 4, 8, 16 };
+    static const struct {
+        const char* name;
+        SchedPolicy policy;
+        SchedServer server;
+    } variants[] = {
+        { "table", POLICY_EDF_TABLE, SERVER_POLLING },
+        { "online", POLICY_EDF_ONLINE, SERVER_POLLING },
+        { "rm", POLICY_RM, SERVER_POLLING },
+        { "slack", POLICY_EDF_TABLE, SERVER_SLACK_STEALING },
+    };
+
+#ifdef SCHED_HOST
+    //only the probe's waits move the virtual clock, so every slot ends inside one
+    timer_host_setReadCost(0);
+#endif
+
+    uint8_t s, v;
+    for (v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        for (s = 0; s < sizeof(sizes); s++) {
+            PeriodicTaskSet ts;
+            SchedParams params;
+            uint32_t hyperperiod = 360;
+            runFlag_t flags = makeTaskSet(&ts, sizes[s], hyperperiod, dispatchProbe);
+
+            params.tasks = ts;
+            params.policy = variants[v].policy;
+            params.server = variants[v].server;
+            params.continuous = false;
+            params.preemptive = false;
+
+            callGaps = (Gaps){ 0 };
+            slotGaps = (Gaps){ 0 };
+            probeStarted = false;
+            if (!flags) flags = run(params);
+
+            if (flags & ERROR_FLAGS || !slotGaps.count || !callGaps.count) {
+                emit("dispatch_error", variants[v].name, ts.size, hyperperiod, flags, "flags");
+            }
+            else {
+                emit("dispatch_slot_mean", variants[v].name, ts.size, hyperperiod, slotGaps.total / slotGaps.count, BENCH_UNIT);
+                emit("dispatch_slot_max", variants[v].name, ts.size, hyperperiod, slotGaps.max, BENCH_UNIT);
+                emit("dispatch_call_mean", variants[v].name, ts.size, hyperperiod, callGaps.total / callGaps.count, BENCH_UNIT);
+            }
+
+            invalidateSchedule();
+            freePeriodicTaskSet(&ts);
+        }
+    }
+
+#ifdef SCHED_HOST
+    timer_host_setReadCost(1);
+#endif
+}
+
+#if SCHED_PROFILE
+//random aperiodic arrivals. each is posted at the first periodic task call at or after its arrival time,
+//which is at most one slot late, and response times are measured from the post
+static uint32_t meanArrivalMillis;
+static uint32_t nextArrival;
+static uint32_t dropped;
+
+static void postArrivals(void) {
+    uint32_t now = timer_getMicros();
+    while ((int32_t)(now - nextArrival) >= 0) {
+        if (addAperiodic(oneMilliTask, 1)) dropped++;
+        nextArrival += (1 + benchRandom() % (2 * meanArrivalMillis - 1)) * 1000;
+    }
+}
+
+static void loadOneMilli(taskFuncFlag_t* flags) {
+    postArrivals();
+    oneMilliTask(flags);
+}
+
+static void loadTwoMillis(taskFuncFlag_t* flags) {
+    postArrivals();
+    twoMillisTask(flags);
+}
+
+//the example task set of main.c, task 0 serving the arrivals
+static void benchResponse(void) {
+    static const uint32_t means[] = { 20, 10 };
+    static const struct {
+        const char* name;
+        SchedPolicy policy;
+        SchedServer server;
+    } variants[] = {
+        { "polling", POLICY_EDF_TABLE, SERVER_POLLING },
+        { "sporadic", POLICY_EDF_ONLINE, SERVER_SPORADIC },
+        { "slack", POLICY_EDF_TABLE, SERVER_SLACK_STEALING },
+    };
+
+    uint8_t m, v;
+    for (m = 0; m < sizeof(means) / sizeof(means[0]); m++) {
+        for (v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+            PeriodicTaskSet ts;
+            SchedParams params;
+            char variant[24];
+            runFlag_t flags = 0;
+            uint32_t n;
+
+            sched_init();
+            flags |= fillPeriodicTask(benchTasks + 0, aperiodicServer, 1, 5);
+            flags |= fillPeriodicTask(benchTasks + 1, loadOneMilli, 1, 4);
+            flags |= fillPeriodicTask(benchTasks + 2, loadTwoMillis, 2, 6);
+            ts.tasks = benchTasks;
+            ts.size = 3;
+
+            params.tasks = ts;
+            params.policy = variants[v].policy;
+            params.server = variants[v].server;
+            params.continuous = false;
+            params.preemptive = false;
+
+            randomState = 2463534242u;
+            meanArrivalMillis = means[m];
+            nextArrival = timer_getMicros();
+            dropped = 0;
+            for (n = 0; n < BENCH_RESPONSE_HYPERPERIODS && !(flags & ERROR_FLAGS); n++) {
+                flags = run(params);
+            }
+
+            const TaskStats* st = sched_aperiodicStats();
+            sprintf(variant, "%s-%lums", variants[v].name, (unsigned long)means[m]);
+            if (flags & ERROR_FLAGS || !st->jobs) {
+                emit("response_error", variant, ts.size, 60 * BENCH_RESPONSE_HYPERPERIODS, flags, "flags");
+            }
+            else {
+                emit("response_mean", variant, ts.size, 60 * BENCH_RESPONSE_HYPERPERIODS, st->latencyTotal / st->jobs, "us");
+                emit("response_max", variant, ts.size, 60 * BENCH_RESPONSE_HYPERPERIODS, st->latencyMax, "us");
+                emit("response_jobs", variant, ts.size, 60 * BENCH_RESPONSE_HYPERPERIODS, st->jobs, "jobs");
+                emit("response_dropped", variant, ts.size, 60 * BENCH_RESPONSE_HYPERPERIODS, dropped, "jobs");
+            }
+
+            invalidateSchedule();
+            freePeriodicTaskSet(&ts);
+        }
+    }
+
+    //leave the queue empty for whoever runs next
+    sched_init();
+}
+#endif
+
+void bench_runAll(void (*out)(const char* line)) {
+    sink = out;
+    counterInit();
+
+    sink("benchmark,variant,tasks,slots,value,unit");
+    benchHyperperiod();
+    benchBuild();
+    benchAperiodic();
+    benchDispatch();
+#if SCHED_PROFILE
+    benchResponse();
+#endif
+}
+
+#endif /* SCHED_BENCH */
@@ -0,0 +1,31 @@
+/*
+ * Bench.h
+ *
+ *  scheduler benchmarks, built into the host or target program that calls bench_runAll()
+ *  every result is one CSV line:
+ *      benchmark,variant,tasks,slots,value,unit
+ *  costs are CPU cycles from the DWT cycle counter on the target and nanoseconds of CLOCK_MONOTONIC on the host,
+ *  each the median of SCHED_BENCH_REPEATS measurements. slot-level results (response times, memory) come from
+ *  the scheduler clock and pools, so they are exact and repeatable under the host virtual clock
+ *
+ *  benchmarks:
+ *      hyperperiod         cost of one leastCommonMultiple() call
+ *      build_*             buildScheduleEDF() time, run entries and bytes by task count and hyperperiod
+ *      aper_post/aper_pop  cost of one aperiodic queue post, and of taking the most urgent job off it
+ *      dispatch_*          scheduler time between a task returning and the next call, within a slot and across slots
+ *      response_*          aperiodic response time under random arrivals, per server (needs SCHED_PROFILE)
+ */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "Scheduler.h"
+
+#ifndef SCHED_BENCH_REPEATS
+#define SCHED_BENCH_REPEATS 9 //measurements per cost, the median is reported
+#endif
+
+//runs every benchmark and hands each result line, without a line ending, to out
+//call sched_init() first. leaves the scheduler pools as it found them
+void bench_runAll(void (*out)(const char* line));
+
+#endif /* BENCH_H_ */
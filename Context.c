@@ -0,0 +1,167 @@
+#include "Context.h"
+
+#ifndef SCHED_HOST
+
+#include <inc/tm4c123gh6pm.h>
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+
+#define CTX_CANARY 0xC0FFEE11UL
+#define EXC_RETURN_THREAD_PSP 0xFFFFFFFDUL //back to thread mode on the process stack, no FPU frame
+#define XPSR_THUMB 0x01000000UL
+
+//where the switch stands, read by the PendSV handler below
+#define CTX_IDLE 0     //the scheduler is running
+#define CTX_ENTERING 1 //the scheduler asked for a switch into running
+#define CTX_RUNNING 2  //running is on the CPU
+#define CTX_LEAVING 3  //running asked to go back to the scheduler
+
+//shared with the handler, which relies on this layout
+typedef struct {
+    Context* running;
+    volatile uint32_t state;
+    uint32_t schedulerReturn; //EXC_RETURN of the scheduler while a context runs
+} ContextSwitch;
+
+ContextSwitch ctx_switch;
+
+void ctx_pendSVHandler(void);
+
+//PendSV is the lowest priority exception, so it only runs once the slot tick ISR is done
+//entering: the scheduler's r4-r11 (and s16-s31 if it used the FPU) go on the main stack, the context's come off its own
+//leaving: the reverse. the context's registers are saved below its exception frame and its sp kept in running->sp
+__asm("    .thumb\n"
+      "    .text\n"
+      "    .global ctx_switch\n"
+      "    .global ctx_pendSVHandler\n"
+      "    .thumbfunc ctx_pendSVHandler\n"
+      "ctx_pendSVHandler:\n"
+      "    CPSID i\n"
+      "    LDR r0, ctx_switchAddress\n"
+      "    LDR r1, [r0, #4]\n"
+      "    CMP r1, #1\n"
+      "    BEQ ctx_enter\n"
+      "    CMP r1, #3\n"
+      "    BEQ ctx_leave\n"
+      "    CPSIE i\n"
+      "    BX lr\n"
+      "ctx_enter:\n"
+      "    STR lr, [r0, #8]\n"
+      "    TST lr, #0x10\n"
+      "    IT EQ\n"
+      "    VPUSHEQ {s16-s31}\n"
+      "    PUSH {r4-r11}\n"
+      "    LDR r1, [r0, #0]\n"
+      "    LDR r2, [r1, #0]\n"
+      "    LDMIA r2!, {r4-r11, lr}\n"
+      "    TST lr, #0x10\n"
+      "    IT EQ\n"
+      "    VLDMIAEQ r2!, {s16-s31}\n"
+      "    MSR PSP, r2\n"
+      "    MOVS r1, #2\n"
+      "    STR r1, [r0, #4]\n"
+      "    CPSIE i\n"
+      "    BX lr\n"
+      "ctx_leave:\n"
+      "    MRS r2, PSP\n"
+      "    TST lr, #0x10\n"
+      "    IT EQ\n"
+      "    VSTMDBEQ r2!, {s16-s31}\n"
+      "    STMDB r2!, {r4-r11, lr}\n"
+      "    LDR r1, [r0, #0]\n"
+      "    STR r2, [r1, #0]\n"
+      "    MOVS r1, #0\n"
+      "    STR r1, [r0, #4]\n"
+      "    LDR lr, [r0, #8]\n"
+      "    POP {r4-r11}\n"
+      "    TST lr, #0x10\n"
+      "    IT EQ\n"
+      "    VPOPEQ {s16-s31}\n"
+      "    CPSIE i\n"
+      "    BX lr\n"
+      "    .align 4\n"
+      "ctx_switchAddress:\n"
+      "    .word ctx_switch\n");
+
+static void pendSwitch(void) {
+    NVIC_INT_CTRL_R = NVIC_INT_CTRL_PEND_SV;
+    __asm(" dsb");
+    __asm(" isb");
+}
+
+void ctx_preempt(void) {
+    bool masked = IntMasterDisable();
+
+    if (ctx_switch.state == CTX_RUNNING) {
+        ctx_switch.state = CTX_LEAVING;
+        pendSwitch();
+    }
+    else if (ctx_switch.state == CTX_ENTERING) {
+        //the tick beat the switch in, so the context does not get on the CPU at all
+        ctx_switch.state = CTX_IDLE;
+    }
+
+    if (!masked) IntMasterEnable();
+}
+
+//first and only frame of every context. a context that has returned is never switched back in
+static void ctx_trampoline(Context* c) {
+    c->entry(c->arg);
+    c->finished = true;
+    ctx_preempt();
+    while (1) { }
+}
+
+void ctx_init(void) {
+    ctx_switch.running = 0;
+    ctx_switch.state = CTX_IDLE;
+    IntRegister(FAULT_PENDSV, ctx_pendSVHandler);
+    IntPrioritySet(FAULT_PENDSV, 0xE0); // Priority 7 (lowest)
+}
+
+void ctx_start(Context* c, uint32_t* stack, uint32_t words, void (*entry)(void* arg), void* arg) {
+    uint32_t* sp = (uint32_t*)((uint32_t)(stack + words) & ~7UL); // AAPCS wants 8-byte alignment at entry
+    uint32_t i;
+
+    c->stack = stack;
+    c->entry = entry;
+    c->arg = arg;
+    c->finished = false;
+    for (i = 0; i < SCHED_STACK_GUARD_WORDS; i++) stack[i] = CTX_CANARY;
+
+    //the exception frame the PendSV handler returns through
+    *--sp = XPSR_THUMB;
+    *--sp = (uint32_t)ctx_trampoline & ~1UL; // pc
+    *--sp = 0;                               // lr, the trampoline never returns
+    *--sp = 0;                               // r12
+    *--sp = 0;                               // r3
+    *--sp = 0;                               // r2
+    *--sp = 0;                               // r1
+    *--sp = (uint32_t)c;                     // r0, the trampoline's argument
+
+    //what the handler restores before returning through it
+    *--sp = EXC_RETURN_THREAD_PSP;
+    for (i = 0; i < 8; i++) *--sp = 0;       // r11 down to r4
+
+    c->sp = sp;
+}
+
+bool ctx_resume(Context* c) {
+    if (c->finished) return true;
+
+    ctx_switch.running = c;
+    ctx_switch.state = CTX_ENTERING;
+    pendSwitch(); // taken right away, this returns once the context is switched back out
+
+    return c->finished;
+}
+
+bool ctx_stackIntact(const Context* c) {
+    uint32_t i;
+    for (i = 0; i < SCHED_STACK_GUARD_WORDS; i++) {
+        if (c->stack[i] != CTX_CANARY) return false;
+    }
+    return true;
+}
+
+#endif /* SCHED_HOST */
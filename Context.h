@@ -0,0 +1,59 @@
+/*
+ * Context.h
+ *
+ *  execution contexts with stacks of their own, for running tasks preemptively. the scheduler runs a context with
+ *  ctx_resume() until the context is preempted from the slot tick or its entry function returns
+ *  on the target the switch is done by the PendSV handler: the scheduler stays on the main stack, contexts run on
+ *  the process stack. the host build in host/ContextHost.c uses ucontext instead, and takes the preemption once the
+ *  emulated interrupt that asked for it returns, see timer_host_pend()
+ */
+#ifndef CONTEXT_H_
+#define CONTEXT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef SCHED_HOST
+#include <ucontext.h>
+#endif
+
+//words at the bottom of every context stack that hold a canary. a task that overflows its stack writes into them
+//before it reaches what lies below, usually the top of the next task's stack, and ctx_stackIntact() then fails
+//the guard is only checked when the scheduler gets control back, so an overflow is caught after the fact, and one that
+//skips past the guard (a large local array) or faults first is not caught at all. the Cortex-M4 has no stack limit
+//register and the MPU is left alone, so nothing stops the write itself
+#ifndef SCHED_STACK_GUARD_WORDS
+#define SCHED_STACK_GUARD_WORDS 16
+#endif
+
+typedef struct {
+#ifndef SCHED_HOST
+    uint32_t* sp; //saved process stack pointer while switched out, the PendSV handler expects it first
+#else
+    ucontext_t uc;
+#endif
+    uint32_t* stack; //lowest word of the stack, where the guard starts
+    void (*entry)(void* arg);
+    void* arg;
+    volatile bool finished; //entry returned
+} Context;
+
+//sets up context switching. call once before any other ctx_ function
+void ctx_init(void);
+
+//prepares c to call entry(arg) on the given stack the next time it is resumed
+//whatever c was doing before is dropped. the lowest SCHED_STACK_GUARD_WORDS words become the guard
+void ctx_start(Context* c, uint32_t* stack, uint32_t words, void (*entry)(void* arg), void* arg);
+
+//runs c until it is preempted or its entry function returns. returns true once it has returned
+//call it from the scheduler only, never from a context
+bool ctx_resume(Context* c);
+
+//ends the running context's turn. ctx_resume() returns in the scheduler as soon as the caller, usually the
+//slot tick ISR, returns. does nothing if no context is running
+void ctx_preempt(void);
+
+//returns false if c has written into the guard at the bottom of its stack, see SCHED_STACK_GUARD_WORDS
+bool ctx_stackIntact(const Context* c);
+
+#endif /* CONTEXT_H_ */
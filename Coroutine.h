@@ -0,0 +1,87 @@
+/*
+ * Coroutine.h
+ *
+ *  stackless coroutines for task functions, in the style of protothreads. a task written with these macros reads top
+ *  to bottom and yields wherever it likes. its resume point and the locals it needs across a yield live in the CoState
+ *  of its Task, so nothing has to be kept in file-scope globals
+ *
+ *  void blink(taskFuncFlag_t* flags) {
+ *      CO_LOCALS(l, struct { uint8_t n; });
+ *      CO_BEGIN(flags);
+ *      for (l->n = 0; l->n < 10; l->n++) {
+ *          toggleLed();
+ *          CO_WAIT_MICROS(500);
+ *      }
+ *      CO_END();
+ *  }
+ *
+ *  FLAG_RESET starts the function over from CO_BEGIN(). reaching CO_END() or CO_FINISH() sets FLAG_FINISHED, and any
+ *  call after that only sets it again until the next FLAG_RESET
+ *  ordinary locals do not survive a yield, keep those in CO_LOCALS(). the macros expand to one switch statement, so a
+ *  coroutine can not yield from inside a switch of its own, and only one of them may appear on a line
+ *  aperiodic jobs all run through one Task, so these are for periodic task functions. an aperiodic coroutine would
+ *  lose its place whenever a more urgent job is served before it finishes
+ */
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+
+#include "Scheduler.h"
+#include "Timer.h"
+
+#define CO_DONE 0xFFFF //resume point of a coroutine that has finished
+
+//declares name as a pointer to the locals of the running task, laid out as the given struct type
+//the type must fit in SCHED_CORO_LOCAL_WORDS words, which is checked at compile time. goes before CO_BEGIN()
+#define CO_LOCALS(name, ...)                                                 \
+    __VA_ARGS__* name = (void*)sched_currentTask()->coro.locals;             \
+    (void)sizeof(char[sizeof(*name) <= sizeof(sched_currentTask()->coro.locals) ? 1 : -1])
+
+//starts the coroutine body, jumping to where the last call left off
+#define CO_BEGIN(flags)                                                      \
+    CoState* co_ = &(sched_currentTask()->coro);                             \
+    taskFuncFlag_t* coFlags_ = (flags);                                      \
+    if (*coFlags_ & FLAG_RESET) co_->line = 0;                               \
+    switch (co_->line) {                                                     \
+    case CO_DONE:                                                            \
+        *coFlags_ |= FLAG_FINISHED;                                          \
+        return;                                                              \
+    case 0:
+
+//gives the rest of this call back to the scheduler, the next call carries on after it
+#define CO_YIELD()                                                           \
+    do {                                                                     \
+        co_->line = __LINE__;                                                \
+        return;                                                              \
+    case __LINE__:;                                                          \
+    } while (0)
+
+//yields until cond is true. cond is evaluated again on every call, so it must not depend on ordinary locals
+#define CO_WAIT_UNTIL(cond)                                                  \
+    do {                                                                     \
+        co_->line = __LINE__;                                                \
+    case __LINE__:                                                           \
+        if (!(cond)) return;                                                 \
+    } while (0)
+
+//yields until the given number of microseconds has passed. unlike timer_waitMicros() it returns to the scheduler
+//while it waits, so a wait may run past slot ticks without a yield error
+#define CO_WAIT_MICROS(micros)                                               \
+    do {                                                                     \
+        co_->since = timer_getMicros();                                      \
+        CO_WAIT_UNTIL(timer_getMicros() - co_->since >= (uint32_t)(micros)); \
+    } while (0)
+
+//ends the job early
+#define CO_FINISH()                                                          \
+    do {                                                                     \
+        co_->line = CO_DONE;                                                 \
+        *coFlags_ |= FLAG_FINISHED;                                          \
+        return;                                                              \
+    } while (0)
+
+//ends the coroutine body
+#define CO_END()                                                             \
+    CO_FINISH();                                                             \
+    }
+
+#endif /* COROUTINE_H_ */
@@ -0,0 +1,194 @@
+#include "Feasibility.h"
+#include "Utils.h"
+#include "FixedPriority.h"
+
+//utilization is kept as the exact fraction free/scale of the processor left over
+//free is negative when the task set asks for more than the whole processor
+typedef struct {
+    int64_t free;
+    uint64_t scale;
+} SpareCapacity;
+
+//computes 1 - U. when the hyperperiod fits in 32 bits this is exact, (H - sum C_i * H / T_i) / H
+//otherwise each C_i / T_i is rounded up to 32 fractional bits, which can only underestimate what is left
+static SpareCapacity spareCapacity(PeriodicTaskSet ts) {
+    SpareCapacity spare;
+    uint32_t h;
+    uint64_t demand = 0;
+    uint8_t i;
+
+    if (leastCommonMultiple(ts, &h)) {
+        for (i = 0; i < ts.size; i++) demand += (uint64_t)ts.tasks[i].task->compTime * (h / ts.tasks[i].period);
+        spare.scale = h;
+    }
+    else {
+        for (i = 0; i < ts.size; i++) {
+            uint64_t c = (uint64_t)ts.tasks[i].task->compTime << 32;
+            demand += (c + ts.tasks[i].period - 1) / ts.tasks[i].period;
+        }
+        spare.scale = (uint64_t)1 << 32;
+    }
+
+    //only a set with absurd compTimes gets here, clamp rather than wrap
+    if (demand > (uint64_t)INT64_MAX) demand = (uint64_t)INT64_MAX;
+    spare.free = (int64_t)spare.scale - (int64_t)demand;
+    return spare;
+}
+
+//floor(free * period / scale) without overflowing 64 bits
+static int64_t spareForPeriod(SpareCapacity spare, uint32_t period) {
+    uint64_t magnitude = spare.free < 0 ? (uint64_t)(-spare.free) : (uint64_t)spare.free;
+    uint64_t whole = magnitude / spare.scale * period;
+    uint64_t rest = (magnitude % spare.scale) * period;
+    uint64_t part = rest / spare.scale;
+    if (spare.free >= 0) return (int64_t)(whole + part);
+    return -(int64_t)(whole + part + (rest % spare.scale != 0)); //round toward negative infinity
+}
+
+static int32_t clampSlack(int64_t s) {
+    if (s > INT32_MAX) return INT32_MAX;
+    if (s < INT32_MIN) return INT32_MIN;
+    return (int32_t)s;
+}
+
+//demand bound function. total compTime of every job released and due within [0, t]
+static uint64_t demandBound(PeriodicTaskSet ts, uint32_t t) {
+    uint64_t demand = 0;
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        PeriodicTask* pt = &(ts.tasks[i]);
+        if (t >= pt->deadline) demand += (uint64_t)((t - pt->deadline) / pt->period + 1) * pt->task->compTime;
+    }
+    return demand;
+}
+
+//length of the synchronous busy period, the fixed point of w = sum ceil(w / T_i) * C_i
+//only called with U <= 1, where it is bounded by the hyperperiod
+static uint32_t busyPeriod(PeriodicTaskSet ts) {
+    uint64_t w = 0;
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) w += ts.tasks[i].task->compTime;
+
+    while (w <= UINT32_MAX) {
+        uint64_t next = 0;
+        for (i = 0; i < ts.size; i++) {
+            uint32_t p = ts.tasks[i].period;
+            next += (w + p - 1) / p * ts.tasks[i].task->compTime;
+        }
+        if (next == w) break;
+        w = next;
+    }
+
+    return w > UINT32_MAX ? UINT32_MAX : (uint32_t)w;
+}
+
+bool checkFeasibilityEDF(PeriodicTaskSet ts, int32_t* slack) {
+    bool constrained = false;
+    uint8_t i;
+
+    //deadlines at or past the period add nothing to the utilization test, only shorter ones need the demand criterion
+    for (i = 0; i < ts.size; i++) {
+        PeriodicTask* pt = &(ts.tasks[i]);
+        if (pt->period == 0 || pt->deadline == 0) return false;
+        if (pt->deadline < pt->period) constrained = true;
+    }
+
+    SpareCapacity spare = spareCapacity(ts);
+    bool feasible = spare.free >= 0;
+
+    //utilization alone bounds the slack, the demand criterion below can only tighten it
+    if (slack) {
+        for (i = 0; i < ts.size; i++) slack[i] = clampSlack(spareForPeriod(spare, ts.tasks[i].period));
+    }
+
+    if (!constrained || !feasible) return feasible;
+
+    //with U <= 1, dbf(t) <= t only has to hold at the absolute deadlines inside the first busy period
+    uint32_t horizon = busyPeriod(ts);
+    uint8_t j;
+    for (j = 0; j < ts.size; j++) {
+        PeriodicTask* pj = &(ts.tasks[j]);
+        uint64_t t;
+        for (t = pj->deadline; t <= horizon; t += pj->period) {
+            int64_t idle = (int64_t)t - (int64_t)demandBound(ts, (uint32_t)t);
+
+            if (idle < 0) feasible = false;
+            if (!slack) {
+                if (!feasible) return false;
+                continue;
+            }
+
+            //every job due by t could grow by this much before t is overloaded
+            for (i = 0; i < ts.size; i++) {
+                PeriodicTask* pi = &(ts.tasks[i]);
+                if (t < pi->deadline) continue;
+
+                int64_t jobs = (int64_t)((t - pi->deadline) / pi->period + 1);
+                int64_t share = idle >= 0 ? idle / jobs : -((-idle + jobs - 1) / jobs);
+                if (share < slack[i]) slack[i] = clampSlack(share);
+            }
+        }
+    }
+
+    return feasible;
+}
+
+bool checkFeasibilityFP(PeriodicTaskSet ts, bool deadlineMonotonic, uint32_t* responseTime) {
+    uint8_t order[FP_MAX_TASKS];
+    bool feasible = true;
+    uint8_t level;
+
+    if (ts.size > FP_MAX_TASKS) return false;
+
+    for (level = 0; level < ts.size; level++) {
+        PeriodicTask* pt = &(ts.tasks[level]);
+        if (pt->period == 0 || pt->deadline == 0) return false;
+    }
+
+    fp_priorityOrder(ts, deadlineMonotonic, order);
+
+    for (level = 0; level < ts.size; level++) {
+        PeriodicTask* pi = &(ts.tasks[order[level]]);
+        uint64_t r = 0;
+        uint64_t q;
+        uint8_t hp;
+
+        //job q of the level-i busy period. with deadline <= period the busy period ends with the first job,
+        //a longer deadline can leave a job pending at the next release, which then waits for it
+        for (q = 0;; q++) {
+            uint64_t own = (q + 1) * pi->task->compTime;
+            uint64_t limit = q * pi->period + pi->deadline; //finishing later than this misses the deadline
+            uint64_t w = own;
+
+            for (hp = 0; hp < level; hp++) w += ts.tasks[order[hp]].task->compTime;
+
+            //iterate to the fixed point, giving up as soon as the deadline is passed
+            while (w <= limit) {
+                uint64_t next = own;
+                for (hp = 0; hp < level; hp++) {
+                    PeriodicTask* pj = &(ts.tasks[order[hp]]);
+                    next += (w + pj->period - 1) / pj->period * pj->task->compTime;
+                }
+                if (next == w) break;
+                w = next;
+            }
+
+            if (w > limit) {
+                r = (uint64_t)pi->deadline + 1;
+                break;
+            }
+            if (w - q * pi->period > r) r = w - q * pi->period;
+
+            //the busy period is over once job q finishes before job q + 1 is released
+            if (w <= (q + 1) * pi->period) break;
+        }
+
+        if (r > pi->deadline) {
+            feasible = false;
+            if (!responseTime) return false;
+        }
+        if (responseTime) responseTime[order[level]] = r > pi->deadline ? UINT32_MAX : (uint32_t)r;
+    }
+
+    return feasible;
+}
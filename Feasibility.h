@@ -0,0 +1,33 @@
+/*
+ * Feasibility.h
+ *
+ *  admission analysis for periodic task sets. these tests only look at compTime, period and deadline,
+ *  so they can reject a task set before any schedule is built or any memory is allocated
+ *  offsets are ignored. every task releasing at once is the worst case, so a set that passes is feasible
+ *  with any offsets, while a set that only works thanks to its offsets is rejected
+ *  deadlines may be shorter than, equal to or longer than the period. run() itself still needs offset + deadline
+ *  <= period (one job of a task in flight at a time), so the tests also serve to size deadlines beyond what it takes
+ */
+#ifndef FEASIBILITY_H_
+#define FEASIBILITY_H_
+
+#include "Scheduler.h"
+
+//tests whether a task set is schedulable by EDF
+//implicit deadlines (deadline == period), and any set where no deadline is shorter than its period, use the utilization
+//bound U <= 1 in O(n). once a deadline is shorter than its period the processor demand criterion is checked over the
+//synchronous busy period, which is pseudo-polynomial in the periods
+//if slack is not NULL it must hold ts.size entries. each one receives how much extra compTime every job of that task
+//could take, on its own, with the set staying feasible. entries are negative for an infeasible set
+bool checkFeasibilityEDF(PeriodicTaskSet ts, int32_t* slack);
+
+//tests whether a task set is schedulable under rate-monotonic or deadline-monotonic fixed priorities
+//uses exact response-time analysis, R = C_i + sum over higher priorities of ceil(R / T_j) * C_j
+//a task whose deadline is longer than its period can still have a job pending when the next is released, so every
+//job in its level-i busy period is checked, w_q = (q + 1) * C_i + sum ceil(w_q / T_j) * C_j, R_q = w_q - q * T_i
+//if responseTime is not NULL it must hold ts.size entries. each one receives the worst-case response time of that task,
+//or UINT32_MAX if it exceeds the task's deadline
+//task sets larger than FP_MAX_TASKS are rejected
+bool checkFeasibilityFP(PeriodicTaskSet ts, bool deadlineMonotonic, uint32_t* responseTime);
+
+#endif /* FEASIBILITY_H_ */
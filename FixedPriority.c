@@ -0,0 +1,144 @@
+#include "FixedPriority.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+//true if task a should get a higher priority than task b
+static bool higherPriority(PeriodicTaskSet ts, uint8_t a, uint8_t b, bool deadlineMonotonic) {
+    uint32_t ka = deadlineMonotonic ? ts.tasks[a].deadline : ts.tasks[a].period;
+    uint32_t kb = deadlineMonotonic ? ts.tasks[b].deadline : ts.tasks[b].period;
+    return ka < kb || (ka == kb && a < b);
+}
+
+void fp_priorityOrder(PeriodicTaskSet ts, bool deadlineMonotonic, uint8_t* order) {
+    //insertion sort, only done once per run
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        uint8_t level = i;
+        while (level > 0 && higherPriority(ts, i, order[level - 1], deadlineMonotonic)) {
+            order[level] = order[level - 1];
+            level--;
+        }
+        order[level] = i;
+    }
+}
+
+bool fp_init(FixedPriority* e, PeriodicTaskSet ts, bool deadlineMonotonic) {
+    if (ts.size > FP_MAX_TASKS) return false;
+
+    fp_priorityOrder(ts, deadlineMonotonic, e->order);
+
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        e->nextRelease[i] = ts.tasks[e->order[i]].offset;
+        e->deadline[i] = 0;
+        ts.tasks[i].task->remainingCompTime = 0;
+    }
+
+    e->nextCheck = 0;
+    e->ready = 0;
+    e->count = ts.size;
+    e->deadlineMonotonic = deadlineMonotonic;
+    return true;
+}
+
+runFlag_t fp_release(FixedPriority* e, PeriodicTaskSet ts, uint32_t slot) {
+    if (slot < e->nextCheck) return 0x0000;
+
+    uint32_t earliest = UINT32_MAX;
+    uint8_t level;
+    for (level = 0; level < e->count; level++) {
+        PeriodicTask* pt = &(ts.tasks[e->order[level]]);
+
+        //the job is still pending at its deadline, it has run out of time
+        if (pt->task->remainingCompTime > 0 && e->deadline[level] <= slot) {
+            return FLAG_DEADLINE_MISS | (e->order[level] << 8);
+        }
+
+        if (e->nextRelease[level] <= slot) {
+            pt->task->remainingCompTime = pt->task->compTime;
+            profile_release(&(pt->task->stats.job), timer_getMicros());
+            if (pt->task->compTime > 0) e->ready |= 0x80000000u >> level;
+            e->deadline[level] = e->nextRelease[level] + pt->deadline;
+            e->nextRelease[level] += pt->period;
+        }
+
+        if (e->nextRelease[level] < earliest) earliest = e->nextRelease[level];
+        if (pt->task->remainingCompTime > 0 && e->deadline[level] < earliest) earliest = e->deadline[level];
+    }
+
+    //a job that finishes before its deadline only costs one scan at that deadline
+    e->nextCheck = earliest;
+    return 0x0000;
+}
+
+int8_t fp_pick(FixedPriority* e) {
+    if (!e->ready) return -1;
+    return (int8_t)SCHED_CLZ(e->ready);
+}
+
+void fp_retire(FixedPriority* e, int8_t level) {
+    e->ready &= ~(0x80000000u >> level);
+}
+
+void fp_rebase(FixedPriority* e, uint32_t slots) {
+    uint8_t level;
+    for (level = 0; level < e->count; level++) {
+        e->nextRelease[level] -= slots;
+        e->deadline[level] -= slots;
+    }
+    e->nextCheck -= slots;
+}
+
+bool fp_addTask(FixedPriority* e, PeriodicTaskSet ts, uint8_t index, uint32_t slot) {
+    if (e->count >= FP_MAX_TASKS) return false;
+
+    uint8_t level = e->count;
+    while (level > 0 && higherPriority(ts, index, e->order[level - 1], e->deadlineMonotonic)) {
+        e->order[level] = e->order[level - 1];
+        e->nextRelease[level] = e->nextRelease[level - 1];
+        e->deadline[level] = e->deadline[level - 1];
+        level--;
+    }
+    e->order[level] = index;
+    e->nextRelease[level] = slot;
+    e->deadline[level] = 0;
+    e->count++;
+
+    //ready bits of the levels from here down shift with them
+    uint32_t above = ~(0xFFFFFFFFu >> level);
+    e->ready = (e->ready & above) | ((e->ready & ~above) >> 1);
+
+    if (slot < e->nextCheck) e->nextCheck = slot;
+    return true;
+}
+
+void fp_removeTask(FixedPriority* e, uint8_t index) {
+    uint8_t level;
+    for (level = 0; level < e->count && e->order[level] != index; level++) { }
+    if (level == e->count) return;
+
+    uint32_t above = ~(0xFFFFFFFFu >> level);
+    uint32_t below = 0x7FFFFFFFu >> level;
+    e->ready = (e->ready & above) | ((e->ready & below) << 1);
+
+    uint8_t l;
+    e->count--;
+    for (l = level; l < e->count; l++) {
+        e->order[l] = e->order[l + 1];
+        e->nextRelease[l] = e->nextRelease[l + 1];
+        e->deadline[l] = e->deadline[l + 1];
+    }
+    for (l = 0; l < e->count; l++) {
+        if (e->order[l] > index) e->order[l]--;
+    }
+
+    //nextCheck may now be earlier than it has to be, which only costs fp_release() one scan
+}
+
+uint32_t fp_nextRelease(const FixedPriority* e, uint8_t index) {
+    uint8_t level;
+    for (level = 0; level < e->count; level++) {
+        if (e->order[level] == index) return e->nextRelease[level];
+    }
+    return UINT32_MAX;
+}
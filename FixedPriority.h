@@ -0,0 +1,66 @@
+/*
+ * FixedPriority.h
+ *
+ *  fixed-priority engine for rate-monotonic and deadline-monotonic scheduling.
+ *  priorities are assigned once when the engine is initialized. ready jobs are kept as bits in a
+ *  32-bit word, highest priority in bit 31, so the next task is found with a single CLZ instruction
+ */
+#ifndef FIXEDPRIORITY_H_
+#define FIXEDPRIORITY_H_
+
+#include "Scheduler.h"
+
+//the ready bitmap has one bit per priority level
+#define FP_MAX_TASKS 32
+
+//count leading zeros. Cortex-M4 has CLZ, TI's compiler exposes it as _norm()
+#if defined(__TI_ARM__)
+#define SCHED_CLZ(x) _norm(x)
+#else
+#define SCHED_CLZ(x) __builtin_clz(x)
+#endif
+
+typedef struct {
+    uint8_t order[FP_MAX_TASKS]; //task index at each priority level, level 0 is the highest
+    uint32_t nextRelease[FP_MAX_TASKS]; //slot of the next release at each priority level
+    uint32_t deadline[FP_MAX_TASKS]; //absolute deadline of the last job released at each priority level
+    uint32_t nextCheck; //earliest next release or pending deadline, lets slots without either skip the scan
+    uint32_t ready; //bit (31 - level) is set while the job at that level has comptime left
+    uint8_t count;
+    bool deadlineMonotonic; //the order fp_init() was asked for, kept for fp_addTask()
+} FixedPriority;
+
+//fills order with the task indices of ts from highest to lowest priority
+//rate monotonic orders by period, deadline monotonic by relative deadline. ties go to the lower index
+void fp_priorityOrder(PeriodicTaskSet ts, bool deadlineMonotonic, uint8_t* order);
+
+//assigns priorities and resets the engine so every task releases its first job at its offset
+//deadlineMonotonic orders by relative deadline instead of period
+//returns false if the task set is larger than FP_MAX_TASKS
+bool fp_init(FixedPriority* e, PeriodicTaskSet ts, bool deadlineMonotonic);
+
+//releases every job due at or before the given slot
+//returns FLAG_DEADLINE_MISS with the task index if a job is still unfinished at its deadline
+runFlag_t fp_release(FixedPriority* e, PeriodicTaskSet ts, uint32_t slot);
+
+//returns the priority level of the highest priority ready job, or -1 if none are ready
+int8_t fp_pick(FixedPriority* e);
+
+//clears the ready bit of the given priority level once its job has no remaining comptime
+void fp_retire(FixedPriority* e, int8_t level);
+
+//subtracts the given number of slots from every pending release and deadline
+void fp_rebase(FixedPriority* e, uint32_t slots);
+
+//gives the task appended to ts at index its priority level. its first job is released at slot
+//levels below it move down one, jobs in flight keep their place. returns false if the engine is full
+bool fp_addTask(FixedPriority* e, PeriodicTaskSet ts, uint8_t index, uint32_t slot);
+
+//drops the task at index and its job, if one is ready. the levels below it move up one
+//tasks after it move down one index, as they do in the task set
+void fp_removeTask(FixedPriority* e, uint8_t index);
+
+//returns the slot the task at index releases its next job at, or UINT32_MAX if it is not tracked
+uint32_t fp_nextRelease(const FixedPriority* e, uint8_t index);
+
+#endif /* FIXEDPRIORITY_H_ */
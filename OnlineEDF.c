@@ -0,0 +1,135 @@
+#include "OnlineEDF.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+//heap order. earlier key first, lower task index breaks ties
+static bool entryBefore(EdfHeapEntry a, EdfHeapEntry b) {
+    return a.key < b.key || (a.key == b.key && a.index < b.index);
+}
+
+static void heapPush(EdfHeapEntry* heap, uint8_t* count, EdfHeapEntry entry) {
+    uint8_t i = (*count)++;
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!entryBefore(entry, heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = entry;
+}
+
+static EdfHeapEntry heapPop(EdfHeapEntry* heap, uint8_t* count) {
+    EdfHeapEntry top = heap[0];
+    EdfHeapEntry last = heap[--(*count)];
+    uint8_t i = 0;
+    while (1) {
+        uint8_t child = 2 * i + 1;
+        if (child >= *count) break;
+        if (child + 1 < *count && entryBefore(heap[child + 1], heap[child])) child++;
+        if (!entryBefore(heap[child], last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count) heap[i] = last;
+    return top;
+}
+
+bool edf_init(OnlineEDF* e, PeriodicTaskSet ts) {
+    if (ts.size > SCHED_MAX_PERIODIC) return false;
+
+    e->releaseCount = 0;
+    e->readyCount = 0;
+
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        EdfHeapEntry entry = { ts.tasks[i].offset, i };
+        ts.tasks[i].task->remainingCompTime = 0;
+        heapPush(e->releases, &e->releaseCount, entry);
+    }
+
+    return true;
+}
+
+runFlag_t edf_release(OnlineEDF* e, PeriodicTaskSet ts, uint32_t slot) {
+    //every queued job has comptime left, so the one due first is late if its deadline has come
+    if (e->readyCount && e->ready[0].key <= slot) {
+        return FLAG_DEADLINE_MISS | (e->ready[0].index << 8);
+    }
+
+    while (e->releaseCount && e->releases[0].key <= slot) {
+        EdfHeapEntry entry = heapPop(e->releases, &e->releaseCount);
+        PeriodicTask* pt = &(ts.tasks[entry.index]);
+
+        //the previous job is still queued, it has run out of time
+        if (pt->task->remainingCompTime > 0) {
+            return FLAG_DEADLINE_MISS | (entry.index << 8);
+        }
+
+        pt->task->remainingCompTime = pt->task->compTime;
+        profile_release(&(pt->task->stats.job), timer_getMicros());
+
+        EdfHeapEntry job = { entry.key + pt->deadline, entry.index };
+        if (pt->task->compTime > 0) heapPush(e->ready, &e->readyCount, job);
+
+        entry.key += pt->period;
+        heapPush(e->releases, &e->releaseCount, entry);
+    }
+
+    return 0x0000;
+}
+
+uint8_t edf_pick(OnlineEDF* e) {
+    if (!e->readyCount) return 0;
+    return e->ready[0].index;
+}
+
+uint32_t edf_earliestDeadline(OnlineEDF* e) {
+    if (!e->readyCount) return UINT32_MAX;
+    return e->ready[0].key;
+}
+
+void edf_retire(OnlineEDF* e) {
+    if (e->readyCount) heapPop(e->ready, &e->readyCount);
+}
+
+//drops the entries of index from a heap and renumbers the ones after it
+//renumbering keeps every comparison between the remaining entries the same, so they only need pushing back once
+static void heapRemoveTask(EdfHeapEntry* heap, uint8_t* count, uint8_t index) {
+    uint8_t kept = 0;
+    uint8_t i;
+    for (i = 0; i < *count; i++) {
+        if (heap[i].index == index) continue;
+        heap[kept] = heap[i];
+        if (heap[kept].index > index) heap[kept].index--;
+        kept++;
+    }
+
+    //pushing entry i only ever writes slots up to i, so this can work in place
+    *count = 0;
+    for (i = 0; i < kept; i++) heapPush(heap, count, heap[i]);
+}
+
+void edf_addTask(OnlineEDF* e, uint8_t index, uint32_t slot) {
+    EdfHeapEntry entry = { slot, index };
+    heapPush(e->releases, &e->releaseCount, entry);
+}
+
+void edf_removeTask(OnlineEDF* e, uint8_t index) {
+    heapRemoveTask(e->releases, &e->releaseCount, index);
+    heapRemoveTask(e->ready, &e->readyCount, index);
+}
+
+uint32_t edf_nextRelease(const OnlineEDF* e, uint8_t index) {
+    uint8_t i;
+    for (i = 0; i < e->releaseCount; i++) {
+        if (e->releases[i].index == index) return e->releases[i].key;
+    }
+    return UINT32_MAX;
+}
+
+void edf_rebase(OnlineEDF* e, uint32_t slots) {
+    //subtracting the same amount from every key keeps both heaps ordered
+    uint8_t i;
+    for (i = 0; i < e->releaseCount; i++) e->releases[i].key -= slots;
+    for (i = 0; i < e->readyCount; i++) e->ready[i].key -= slots;
+}
@@ -0,0 +1,59 @@
+/*
+ * OnlineEDF.h
+ *
+ *  table-free EDF engine. instead of a schedule with one entry per slot of the hyperperiod,
+ *  jobs are tracked in two binary heaps: one ordered by the next release of each task and
+ *  one ordered by the absolute deadline of each released, unfinished job.
+ *  memory is O(n) in the number of tasks and each slot costs O(log n)
+ */
+#ifndef ONLINEEDF_H_
+#define ONLINEEDF_H_
+
+#include "Scheduler.h"
+
+//heap entry. key is an absolute slot number, either a release time or a deadline
+typedef struct {
+    uint32_t key;
+    uint8_t index; //index of the task in the task set
+} EdfHeapEntry;
+
+typedef struct {
+    EdfHeapEntry releases[SCHED_MAX_PERIODIC]; //every task, ordered by next release
+    EdfHeapEntry ready[SCHED_MAX_PERIODIC]; //released and unfinished jobs, ordered by deadline
+    uint8_t releaseCount;
+    uint8_t readyCount;
+} OnlineEDF;
+
+//resets the engine so that every task releases its first job at its offset
+//returns false if the task set is larger than SCHED_MAX_PERIODIC
+bool edf_init(OnlineEDF* e, PeriodicTaskSet ts);
+
+//releases every job due at or before the given slot
+//returns FLAG_DEADLINE_MISS with the task index if a job is still unfinished at its deadline
+runFlag_t edf_release(OnlineEDF* e, PeriodicTaskSet ts, uint32_t slot);
+
+//returns the index of the released job with the earliest deadline
+//if no job is ready, index 0 is returned so that the aperiodic server runs
+uint8_t edf_pick(OnlineEDF* e);
+
+//returns the deadline of the job edf_pick() would return, or UINT32_MAX if no job is ready
+uint32_t edf_earliestDeadline(OnlineEDF* e);
+
+//removes the job returned by edf_pick() once it has no remaining comptime
+void edf_retire(OnlineEDF* e);
+
+//subtracts the given number of slots from every release and deadline
+//called at hyperperiod boundaries so slot numbers never wrap
+void edf_rebase(OnlineEDF* e, uint32_t slots);
+
+//starts tracking a task appended to the task set at the given index. its first job is released at slot
+void edf_addTask(OnlineEDF* e, uint8_t index, uint32_t slot);
+
+//stops tracking the task at index, dropping its pending release and any job of it still queued
+//tasks after it move down one index, as they do in the task set
+void edf_removeTask(OnlineEDF* e, uint8_t index);
+
+//returns the slot the task at index releases its next job at, or UINT32_MAX if it is not tracked
+uint32_t edf_nextRelease(const OnlineEDF* e, uint8_t index);
+
+#endif /* ONLINEEDF_H_ */
@@ -0,0 +1,35 @@
+#include "Pool.h"
+
+void* pool_alloc(Pool* p) {
+    void* block;
+
+    if (p->freeList) {
+        block = p->freeList;
+        p->freeList = *(void**)block;
+    }
+    else if (p->next < p->capacity) {
+        block = p->storage + (uint32_t)p->next * p->blockSize;
+        p->next++;
+    }
+    else {
+        return 0;
+    }
+
+    p->used++;
+    if (p->used > p->highWater) p->highWater = p->used;
+    return block;
+}
+
+void pool_free(Pool* p, void* block) {
+    if (!pool_owns(p, block)) return;
+
+    *(void**)block = p->freeList;
+    p->freeList = block;
+    p->used--;
+}
+
+bool pool_owns(const Pool* p, const void* block) {
+    const uint8_t* b = (const uint8_t*)block;
+    if (b < p->storage || b >= p->storage + (uint32_t)p->capacity * p->blockSize) return false;
+    return (uint32_t)(b - p->storage) % p->blockSize == 0;
+}
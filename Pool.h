@@ -0,0 +1,36 @@
+/*
+ * Pool.h
+ *
+ *  fixed-size block pool over statically allocated storage, so the scheduler never touches the heap.
+ *  allocating and freeing are O(1): freed blocks go on an intrusive free list and blocks that were never
+ *  handed out are taken from the end of the storage, so no setup pass over the storage is needed
+ */
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t* storage; //first block
+    void* freeList; //blocks that were freed, linked through their first word
+    uint16_t blockSize; //bytes per block, at least the size of a pointer
+    uint16_t capacity; //number of blocks in storage
+    uint16_t next; //blocks before this index have been handed out at least once
+    uint16_t used; //blocks currently allocated
+    uint16_t highWater; //most blocks ever allocated at once
+} Pool;
+
+//initializer for a pool over a statically allocated array, e.g. static Pool p = POOL_STATIC(taskStorage);
+#define POOL_STATIC(array) { (uint8_t*)(array), 0, sizeof((array)[0]), sizeof(array) / sizeof((array)[0]), 0, 0, 0 }
+
+//returns a block, or NULL if every block is in use
+void* pool_alloc(Pool* p);
+
+//returns a block to the pool. pointers that did not come from this pool are ignored
+void pool_free(Pool* p, void* block);
+
+//true if the pointer is a block of this pool
+bool pool_owns(const Pool* p, const void* block);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,77 @@
+#include "Profiler.h"
+
+#if SCHED_PROFILE
+
+void profile_reset(TaskStats* stats) {
+    uint8_t i;
+
+    stats->calls = 0;
+    stats->callMin = UINT32_MAX;
+    stats->callMax = 0;
+    stats->callTotal = 0;
+    stats->jobs = 0;
+    stats->demandMax = 0;
+    stats->demandTotal = 0;
+    stats->startMin = UINT32_MAX;
+    stats->startMax = 0;
+    stats->latencyMax = 0;
+    stats->latencyTotal = 0;
+    for (i = 0; i < SCHED_PROFILE_BUCKETS; i++) stats->histogram[i] = 0;
+
+    stats->job.releasedAt = 0;
+    stats->job.demand = 0;
+    stats->job.started = false;
+    stats->job.active = false;
+}
+
+void profile_release(JobProfile* job, uint32_t now) {
+    job->releasedAt = now;
+    job->demand = 0;
+    job->started = false;
+    job->active = true;
+}
+
+//floor(log2(micros)), clamped to the last bucket
+static uint8_t bucket(uint32_t micros) {
+    uint8_t k = 0;
+    while (micros > 1 && k < SCHED_PROFILE_BUCKETS - 1) {
+        micros >>= 1;
+        k++;
+    }
+    return k;
+}
+
+void profile_call(TaskStats* stats, JobProfile* job, uint32_t start, uint32_t end) {
+    uint32_t micros = end - start;
+
+    stats->calls++;
+    stats->callTotal += micros;
+    if (micros < stats->callMin) stats->callMin = micros;
+    if (micros > stats->callMax) stats->callMax = micros;
+    stats->histogram[bucket(micros)]++;
+
+    if (!job->active) return;
+
+    if (!job->started) {
+        uint32_t latency = start - job->releasedAt;
+        if (latency < stats->startMin) stats->startMin = latency;
+        if (latency > stats->startMax) stats->startMax = latency;
+        job->started = true;
+    }
+    job->demand += micros;
+}
+
+void profile_finish(TaskStats* stats, JobProfile* job, uint32_t now) {
+    if (!job->active) return;
+    job->active = false;
+
+    uint32_t latency = now - job->releasedAt;
+
+    stats->jobs++;
+    stats->demandTotal += job->demand;
+    if (job->demand > stats->demandMax) stats->demandMax = job->demand;
+    stats->latencyTotal += latency;
+    if (latency > stats->latencyMax) stats->latencyMax = latency;
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Profiler.h
+ *
+ *  collects the TaskStats kept in every Task. stats are split from the per-job JobProfile so that
+ *  aperiodic jobs, which only live while queued, can add to one shared TaskStats
+ *  every function compiles to nothing when SCHED_PROFILE is 0
+ */
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "Scheduler.h"
+
+#if SCHED_PROFILE
+
+//clears all statistics
+void profile_reset(TaskStats* stats);
+
+//starts a new job released at the given time
+void profile_release(JobProfile* job, uint32_t now);
+
+//records one call of the job's task function that ran from start to end
+void profile_call(TaskStats* stats, JobProfile* job, uint32_t start, uint32_t end);
+
+//records that the job finished at the given time. ignored if the job already finished
+void profile_finish(TaskStats* stats, JobProfile* job, uint32_t now);
+
+#else
+
+#define profile_reset(stats) ((void)0)
+#define profile_release(job, now) ((void)0)
+#define profile_call(stats, job, start, end) ((void)0)
+#define profile_finish(stats, job, now) ((void)0)
+
+#endif
+
+#endif /* PROFILER_H_ */
@@ -1,240 +1,1203 @@
 #include "Scheduler.h"
 #include "Utils.h"
+#include "OnlineEDF.h"
+#include "FixedPriority.h"
+#include "Feasibility.h"
+#include "Pool.h"
+#include "AperQueue.h"
+#include "SporadicServer.h"
+#include "SlackStealer.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "Context.h"
 #include "Timer.h" //NOTE: Timer code is from CPRE 288 and was not developed by me
 
-#include <stdlib.h>
+#include <stddef.h>
 
-AperList aperList;
+AperQueue aperQueue; //jobs waiting for the aperiodic server
+
+//static storage for every object the scheduler hands out. see SCHED_MAX_* in Scheduler.h
+static Task taskStorage[SCHED_MAX_TASKS];
+static PeriodicTask periodicStorage[SCHED_MAX_PERIODIC];
+static PeriodicSchedule scheduleStorage[SCHED_MAX_SCHEDULES];
+static Pool taskPool = POOL_STATIC(taskStorage);
+static Pool periodicPool = POOL_STATIC(periodicStorage);
+static Pool schedulePool = POOL_STATIC(scheduleStorage);
+
+//schedule runs come from one arena. the schedule being built always sits at the top so it can grow in place,
+//and freeing a schedule slides every run above it down, so the arena holds exactly the live schedules whatever
+//order they are freed in
+static ScheduleRun runStorage[SCHED_MAX_SCHEDULE_RUNS];
+static uint32_t runTop = 0;
+static uint32_t runHighWater = 0;
+
+//time spent asleep, see sched_idleMicros()
+static uint64_t idleMicros = 0;
+
+#if SCHED_PROFILE
+static TaskStats aperiodicStats; //shared by every aperiodic job, see sched_aperiodicStats()
+#endif
+
+//the Task every aperiodic job runs through, loaded from the queued job for each call
+static Task aperiodicTask;
+
+//the task being called, see sched_currentTask()
+static Task* callingTask = NULL;
+
+//the task set run() dispatches, see sched_taskSet()
+static PeriodicTask liveStorage[SCHED_MAX_PERIODIC];
+static PeriodicTaskSet liveTasks = { liveStorage, 0 };
+
+//changes waiting for a point where they disturb no job, see admitPeriodic()
+static PeriodicTask admissions[SCHED_MAX_ADMISSIONS];
+static uint8_t admissionCount = 0;
+static bool retiring[SCHED_MAX_PERIODIC]; //retired tasks still in liveTasks
+static uint8_t retiringCount = 0;
+static const SchedParams* activeParams = NULL; //the run() in progress, NULL outside of one
+
+//operating modes, see sched_defineMode()
+typedef struct {
+    PeriodicTaskSet tasks;
+    PeriodicSchedule* schedule; //built when the mode was defined, NULL if it could not be
+    bool defined;
+} SchedMode;
+
+static SchedMode modes[SCHED_MAX_MODES];
+static int8_t modeRequest = -1; //mode waiting for a safe point to switch to
+static int8_t currentMode = -1;
+
+//jobs abandoned by preemptive runs, see sched_overruns()
+static uint32_t overruns = 0;
+
+#if SCHED_PREEMPTIVE
+//one preemptive job per periodic task but task 0, which stays cooperative
+typedef struct {
+    Context context;
+    Task* task;
+    taskFuncFlag_t flags;
+} PreemptiveJob;
+
+static PreemptiveJob jobs[SCHED_MAX_PERIODIC - 1];
+static uint32_t stacks[SCHED_MAX_PERIODIC - 1][SCHED_STACK_WORDS];
+static bool preemptiveRun = false; //the run() in progress was asked to be preemptive
+#endif
 
 void sched_init() {
+    aperQueue_init(&aperQueue);
+    idleMicros = 0;
+    overruns = 0;
+    modeRequest = -1;
+    currentMode = -1;
+#if SCHED_PREEMPTIVE
+    ctx_init();
+#endif
+    profile_reset(&aperiodicStats);
+    trace_init();
     timer_init();
     timer_pause();
 }
 
-runFlag_t run(SchedParams params) {
-    PeriodicSchedule* schedule = buildScheduleEDF(params.tasks);
+//schedule cache. a schedule only depends on the timing of the tasks it was built from, in order,
+//so it is kept between calls to run() until that timing changes
+//the timing is kept in full rather than as a hash, so no change can be mistaken for the cached set
+typedef struct {
+    uint32_t compTime;
+    uint32_t period;
+    uint32_t deadline;
+    uint32_t offset;
+} TaskTiming;
 
-    uint32_t i;
-    for (i = 0; i < schedule->size; i++) {
-        uint8_t currentTaskIndex = schedule->indices[i];
-        PeriodicTask* currentTask = &(params.tasks.tasks[currentTaskIndex]);
+static PeriodicSchedule* cachedSchedule = NULL;
+static TaskTiming cachedTiming[SCHED_MAX_PERIODIC];
+static uint8_t cachedSize = 0;
 
-        taskFuncFlag_t flags = 0;
+static bool sameTiming(const TaskTiming* t, const PeriodicTask* pt) {
+    return t->compTime == pt->task->compTime && t->period == pt->period && t->deadline == pt->deadline &&
+           t->offset == pt->offset;
+}
 
-        //if we are at a multiple of the task's period then it is new.
-        if (i % currentTask->period == 0) {
-            currentTask->task->remainingCompTime = currentTask->task->compTime;
-            flags |= FLAG_RESET;  // prepare reset flag
-        }
+static PeriodicSchedule* buildSchedule(PeriodicTaskSet ts, runFlag_t* error);
+
+PeriodicSchedule* getSchedule(PeriodicTaskSet ts, runFlag_t* error) {
+    uint8_t i;
+
+    if (cachedSchedule && cachedSize == ts.size) {
+        for (i = 0; i < ts.size && sameTiming(&(cachedTiming[i]), &(ts.tasks[i])); i++) { }
+        if (i == ts.size) return cachedSchedule;
+    }
+
+    invalidateSchedule();
+    cachedSchedule = buildSchedule(ts, error);
+    if (!cachedSchedule) return NULL;
+
+    //a built schedule means the set had at most SCHED_MAX_PERIODIC tasks
+    for (i = 0; i < ts.size; i++) {
+        cachedTiming[i].compTime = ts.tasks[i].task->compTime;
+        cachedTiming[i].period = ts.tasks[i].period;
+        cachedTiming[i].deadline = ts.tasks[i].deadline;
+        cachedTiming[i].offset = ts.tasks[i].offset;
+    }
+    cachedSize = ts.size;
+
+    return cachedSchedule;
+}
+
+void invalidateSchedule(void) {
+    if (cachedSchedule) freePeriodicSchedule(cachedSchedule);
+    cachedSchedule = NULL;
+    cachedSize = 0;
+}
+
+//sleep condition for timer_idle(), checked with interrupts masked so a post can't slip in before the sleep
+static bool noAperiodicWork(void) {
+    return aperQueue_count(&aperQueue) == 0;
+}
+
+#if SCHED_PREEMPTIVE
+//entry of every preemptive job. the task function sees FLAG_RESET once and the job is over when it returns
+static void runJob(void* arg) {
+    PreemptiveJob* job = arg;
+    job->flags = FLAG_RESET;
+    job->task->function(&(job->flags));
+}
+
+//runs the job of a preemptive task until the slot tick or until it returns
+//*handOff is set if the job returned with time left in the slot, which then goes to task 0
+static runFlag_t dispatchPreemptive(PeriodicTask* currentTask, uint8_t index, bool newJob, unsigned int slot_tick, bool* handOff) {
+    PreemptiveJob* job = &(jobs[index - 1]);
+    Task* task = currentTask->task;
+
+    //a job abandoned by an overrun is simply dropped here
+    if (newJob) {
+        job->task = task;
+        ctx_start(&(job->context), stacks[index - 1], SCHED_STACK_WORDS, runJob, job);
+    }
+
+#if SCHED_PROFILE
+    unsigned int call_start = timer_getMicros();
+#endif
+
+    timer_resume();
+    callingTask = task;
+    bool done = ctx_resume(&(job->context));
+
+#if SCHED_PROFILE
+    unsigned int call_end = timer_getMicros();
+    profile_call(&(task->stats), &(task->stats.job), call_start, call_end);
+    if (done) profile_finish(&(task->stats), &(task->stats.job), call_end);
+#endif
+
+    trace_event(TRACE_YIELD, index);
+
+    if (!ctx_stackIntact(&(job->context))) return FLAG_STACK_OVERFLOW | (index << 8);
 
-        //if current task's remainingCompTime is out of bounds, run aperiodic server instead
-        if (currentTask->task->remainingCompTime-- <= 0) currentTask = params.tasks.tasks;
+    if (done) {
+        trace_event(TRACE_FINISH, index);
+        if (job->flags & FLAG_EXIT) return FLAG_EXIT | (index << 8);
 
-        unsigned int prev_time = timer_getMicros();
+        task->remainingCompTime = 0;
+        *handOff = timer_fireCount() == slot_tick;
+    }
+    else if (task->remainingCompTime == 0) {
+        //out of time and still running. the rest of the job is lost, but the run goes on
+        overruns++;
+        trace_event(TRACE_OVERRUN, index);
+    }
+
+    return 0x0000;
+}
+#endif
+
+//runs the job of the task at the given index for one time slot
+static runFlag_t dispatchSlot(PeriodicTaskSet ts, uint8_t currentTaskIndex) {
+    PeriodicTask* currentTask = &(ts.tasks[currentTaskIndex]);
+
+    taskFuncFlag_t flags = 0;
+
+    //if the current job has already finished, run the aperiodic server instead
+    if (currentTask->task->remainingCompTime == 0) {
+        currentTaskIndex = 0;
+        currentTask = ts.tasks;
+    }
+
+    //a job that has not been given any time yet is new
+    if (currentTask->task->remainingCompTime == currentTask->task->compTime) {
+        flags |= FLAG_RESET;  // prepare reset flag
+    }
+
+    if (currentTask->task->remainingCompTime > 0) currentTask->task->remainingCompTime--;
+
+    trace_event(TRACE_SLOT, currentTaskIndex);
+
+    //the slot ends at the next tick of the slot timer started by run()
+    unsigned int slot_tick = timer_fireCount();
+    bool finished = false;
+
+#if SCHED_PREEMPTIVE
+    if (preemptiveRun && currentTaskIndex > 0) {
+        bool handOff = false;
+        runFlag_t result = dispatchPreemptive(currentTask, currentTaskIndex, flags & FLAG_RESET, slot_tick, &handOff);
+        if (result || !handOff) return result;
+
+        //task 0 gets whatever is left of the slot
+        currentTaskIndex = 0;
+        currentTask = ts.tasks;
+        flags = 0;
+    }
+#endif
+
+    //each call is timed from the end of the one before, so the yield limit and profiling cost one timer read per call
+#if SCHED_PROFILE
+    TaskStats* stats = &(currentTask->task->stats);
+#endif
+    unsigned int call_start = timer_getMicros();
+
+    while (1) {
+        timer_resume();
+
+        //call function
+        callingTask = currentTask->task;
+        currentTask->task->function(&flags);
+
+        unsigned int call_end = timer_getMicros();
+        unsigned int call_micros = call_end - call_start;
+#if SCHED_PROFILE
+        profile_call(stats, &(stats->job), call_start, call_end);
+        if (flags & FLAG_FINISHED) profile_finish(stats, &(stats->job), call_end);
+#endif
+        call_start = call_end;
 
-        while (1) {
-            timer_resume();
+        unsigned int tick = timer_fireCount();
 
-            //call function
-            currentTask->task->function(&flags);
+        //if reset flag is set, clear it
+        flags &= ~FLAG_RESET;
 
-            unsigned int time = timer_getMicros();
+        trace_event(TRACE_YIELD, currentTaskIndex);
+        if ((flags & FLAG_FINISHED) && !finished) trace_event(TRACE_FINISH, currentTaskIndex);
+        finished = flags & FLAG_FINISHED;
 
-            //if reset flag is set, clear it
-            flags &= ~FLAG_RESET;
+        //a task with nothing to do sleeps the core until the slot tick or an aperiodic post wakes it
+        if (flags & FLAG_IDLE) {
+            flags &= ~FLAG_IDLE;
 
-            if (flags & FLAG_EXIT) {
-                return stopRun(FLAG_EXIT | (currentTaskIndex << 8), schedule);
+            if (tick == slot_tick) {
+                //idle time is when the trace gets sent
+                trace_drain();
+                trace_event(TRACE_IDLE, currentTaskIndex);
+
+                uint64_t idle_start = timer_getMicros64();
+                timer_idle(noAperiodicWork);
+                uint64_t idle_end = timer_getMicros64();
+                idleMicros += idle_end - idle_start;
+                call_start = (unsigned int)idle_end;
+
+                tick = timer_fireCount();
             }
+        }
+
+        if (flags & FLAG_EXIT) {
+            return FLAG_EXIT | (currentTaskIndex << 8);
+        }
+
+        //if a single call ran for longer than the yield limit, the task did not yield often enough
+        //it may need adjusted or be incompatible with this scheduler
+        if (call_micros > SCHED_YIELD_LIMIT_US) {
+            trace_event(TRACE_OVERRUN, currentTaskIndex);
+            return FLAG_YIELD_ERROR | (currentTaskIndex << 8);
+        }
+        else if (tick != slot_tick) {
+            break;
+        }
+    }
+
+    //if task has run out of remainingCompTime but function did not finish, indicate that the task was not assigned enough time
+    if (currentTask->task->remainingCompTime == 0 && !(flags & FLAG_FINISHED)) {
+        trace_event(TRACE_OVERRUN, currentTaskIndex);
+        return FLAG_INSUFFICIENT_COMPTIME | (currentTaskIndex << 8);
+    }
+
+    //if task has NOT run out of remainingCompTime but function DID finish, set task's remainingCompTime to zero.
+    //we will schedule the aperiodic server in its place
+    if (currentTask->task->remainingCompTime > 0 && flags & FLAG_FINISHED) {
+        currentTask->task->remainingCompTime = 0;
+    }
+
+    return 0x0000;
+}
 
-            //if more than 2 milliseconds have passed, the task did not yield often enough
-            //it may need adjusted or be incompatible with this scheduler
-            if (time - prev_time > 2000) {
-                return stopRun(FLAG_YIELD_ERROR | (currentTaskIndex << 8), schedule);
+//dispatches a single hyperperiod of a precomputed schedule
+//with a slack stealer, queued aperiodic work takes any slot it can have without a periodic deadline miss
+static runFlag_t runHyperperiod(PeriodicTaskSet ts, PeriodicSchedule* schedule, SlackStealer* stealer) {
+    uint32_t i = 0;
+    uint32_t r;
+    for (r = 0; r < schedule->runCount; r++) {
+        ScheduleRun current = schedule->runs[r];
+        uint32_t runStart = i;
+        uint8_t k;
+        for (k = 0; k < current.length; k++, i++) {
+            runFlag_t flags;
+            uint8_t j;
+
+            //release a new job of every task whose period starts at this slot
+            for (j = 0; j < ts.size; j++) {
+                if (i % ts.tasks[j].period == ts.tasks[j].offset) {
+                    if (stealer && (flags = slack_release(stealer, ts, j))) return flags;
+                    ts.tasks[j].task->remainingCompTime = ts.tasks[j].task->compTime;
+                    profile_release(&(ts.tasks[j].task->stats.job), timer_getMicros());
+                }
             }
-            else if (time - prev_time > 1000) {
-                break;
+
+            uint8_t index = current.index;
+            bool repaid = false;
+
+            if (stealer) {
+                //slots given to task 0, idle slots and slots freed by early completion are all free
+                bool free = index == 0 || ts.tasks[index].task->remainingCompTime == 0;
+                uint8_t victim = free ? 0 : index;
+
+                if (aperQueue_peek(&aperQueue) && slack_canSteal(stealer, ts, schedule, r, runStart, i, victim)) {
+                    if (victim) slack_steal(stealer, ts, victim, i);
+                    index = 0;
+                }
+                else if (free && (j = slack_repayTarget(stealer))) {
+                    index = j;
+                    repaid = true;
+                }
             }
 
-            prev_time = time;
+            flags = dispatchSlot(ts, index);
+            if (flags) return flags;
+
+            if (stealer) slack_settle(stealer, ts, index, repaid);
+        }
+    }
+
+    return 0x0000;
+}
+
+//starts the slot tick. in a preemptive run each tick also takes the CPU back from a preemptive job
+static void startSlots(void) {
+#if SCHED_PREEMPTIVE
+    if (preemptiveRun) {
+        timer_fireEveryMicros(ctx_preempt, SCHED_QUANTUM_US);
+        return;
+    }
+#endif
+    timer_fireEveryMicros(NULL, SCHED_QUANTUM_US);
+}
+
+//stops the slot tick started before dispatching and flushes what the trace can send
+static void stopSlots(runFlag_t flags) {
+    timer_fireStop();
+    if (flags & FLAG_DEADLINE_MISS) trace_event(TRACE_MISS, (flags & FLAG_TASKINDEX) >> 8);
+    trace_drain();
+}
+
+//with a sporadic server the engines only see tasks 1..n-1, task 0 competes through the server instead
+static PeriodicTaskSet engineTasks(PeriodicTaskSet ts, SporadicServer* server) {
+    PeriodicTaskSet periodic = ts;
+    if (server) {
+        periodic.tasks++;
+        periodic.size--;
+    }
+    return periodic;
+}
+
+//true if the sporadic server has budget and work this slot. always false without a server
+static bool serverEligible(SporadicServer* server, uint32_t slot) {
+    return server && ss_update(server, slot, aperQueue_peek(&aperQueue) != NULL);
+}
+
+//true if admitPeriodic(), retirePeriodic() or requestMode() left run() something to do
+static bool changesWaiting(void) {
+    return admissionCount || retiringCount || modeRequest >= 0;
+}
+
+//forgets admissions and retirements still waiting
+static void dropChanges(void) {
+    uint8_t i;
+    for (i = 0; i < liveTasks.size; i++) retiring[i] = false;
+    retiringCount = 0;
+    admissionCount = 0;
+}
+
+//true if a and b are the same task, released the same way
+static bool samePeriodic(const PeriodicTask* a, const PeriodicTask* b) {
+    return a->task == b->task && a->period == b->period && a->deadline == b->deadline && a->offset == b->offset;
+}
+
+//true if task is one of tasks 1..n-1 of ts
+static bool hasPeriodic(PeriodicTaskSet ts, const PeriodicTask* task) {
+    uint8_t i;
+    for (i = 1; i < ts.size; i++) {
+        if (samePeriodic(&(ts.tasks[i]), task)) return true;
+    }
+    return false;
+}
+
+//adds a task to the end of the running set. its first job is released by the engine, or at the next boundary
+static void appendLive(const PeriodicTask* task) {
+    liveStorage[liveTasks.size] = *task;
+    liveStorage[liveTasks.size].task->remainingCompTime = 0;
+    retiring[liveTasks.size] = false;
+    liveTasks.size++;
+}
+
+//removes the task at index from the running set, moving the tasks after it down one
+static void removeLive(uint8_t index) {
+    if (retiring[index]) retiringCount--;
+
+    liveTasks.size--;
+    uint8_t i;
+    for (i = index; i < liveTasks.size; i++) {
+        liveStorage[i] = liveStorage[i + 1];
+        retiring[i] = retiring[i + 1];
+    }
+}
+
+//applies every waiting change at once, for when no job is in flight: a table boundary or the end of a run
+//a mode switch replaces the whole set, anything else waiting with it
+static void settleChanges(void) {
+    uint8_t i;
+    if (modeRequest >= 0) {
+        PeriodicTaskSet next = modes[modeRequest].tasks;
+        liveTasks.size = 0;
+        for (i = 0; i < next.size; i++) appendLive(&(next.tasks[i]));
+        dropChanges();
+
+        currentMode = modeRequest;
+        modeRequest = -1;
+        return;
+    }
+
+    for (i = liveTasks.size; i-- > 0;) {
+        if (retiring[i]) removeLive(i);
+    }
+    for (i = 0; i < admissionCount; i++) appendLive(&(admissions[i]));
+    admissionCount = 0;
+}
+
+//switches an online run to the requested mode. only called with no job pending, so nothing is cut short
+//tasks in both modes keep their engine entries, and with them their phase
+static runFlag_t switchOnline(OnlineEDF* edf, FixedPriority* fp, SporadicServer* server, uint32_t slot) {
+    PeriodicTaskSet next = modes[modeRequest].tasks;
+    uint8_t offset = server ? 1 : 0;
+    uint8_t i;
+
+    for (i = liveTasks.size; i-- > 1;) {
+        if (hasPeriodic(next, &(liveTasks.tasks[i]))) continue;
+
+        if (edf) edf_removeTask(edf, i - offset);
+        else fp_removeTask(fp, i - offset);
+        removeLive(i);
+    }
+
+    for (i = 1; i < next.size; i++) {
+        if (hasPeriodic(liveTasks, &(next.tasks[i]))) continue;
+        appendLive(&(next.tasks[i]));
+
+        uint8_t index = liveTasks.size - 1 - offset;
+        uint32_t release = slot + next.tasks[i].offset;
+        if (edf) edf_addTask(edf, index, release);
+        else if (!fp_addTask(fp, engineTasks(liveTasks, server), index, release)) return FLAG_SCHEDULE_ERROR;
+    }
+
+    dropChanges();
+    currentMode = modeRequest;
+    modeRequest = -1;
+
+    return 0x0000;
+}
+
+//brings the running set up to date at the start of a slot of an online engine, either edf or fp
+//admitted tasks join straight away, retired ones leave once their next job is due, by which time their last is over
+static runFlag_t changeOnline(OnlineEDF* edf, FixedPriority* fp, SporadicServer* server, uint32_t slot) {
+    uint8_t offset = server ? 1 : 0;
+    uint8_t i;
+
+    if (modeRequest >= 0 && (edf ? edf->readyCount == 0 : fp->ready == 0)) {
+        return switchOnline(edf, fp, server, slot);
+    }
+
+    for (i = liveTasks.size; i-- > 1;) {
+        if (!retiring[i]) continue;
+
+        uint32_t next = edf ? edf_nextRelease(edf, i - offset) : fp_nextRelease(fp, i - offset);
+        if (next > slot) continue;
+        if (liveTasks.tasks[i].task->remainingCompTime > 0) return FLAG_DEADLINE_MISS | (i << 8);
+
+        if (edf) edf_removeTask(edf, i - offset);
+        else fp_removeTask(fp, i - offset);
+        removeLive(i);
+    }
+
+    for (i = 0; i < admissionCount; i++) {
+        appendLive(&(admissions[i]));
+
+        uint8_t index = liveTasks.size - 1 - offset;
+        uint32_t release = slot + admissions[i].offset;
+        if (edf) edf_addTask(edf, index, release);
+        else if (!fp_addTask(fp, engineTasks(liveTasks, server), index, release)) return FLAG_SCHEDULE_ERROR;
+    }
+    admissionCount = 0;
+
+    return 0x0000;
+}
+
+//dispatches a single hyperperiod by making EDF decisions as it goes
+static runFlag_t runHyperperiodOnline(OnlineEDF* engine, SporadicServer* server, uint32_t hyperperiod) {
+    PeriodicTaskSet ts = liveTasks;
+    PeriodicTaskSet periodic = engineTasks(ts, server);
+    uint8_t offset = server ? 1 : 0;
+    uint32_t i;
+    for (i = 0; i < hyperperiod; i++) {
+        runFlag_t flags;
+        if (changesWaiting()) {
+            if ((flags = changeOnline(engine, NULL, server, i))) return flags;
+            ts = liveTasks;
+            periodic = engineTasks(ts, server);
+        }
+
+        flags = edf_release(engine, periodic, i);
+        if (flags) return flags + (offset << 8);
+
+        bool ready = engine->readyCount > 0;
+        uint8_t index = ready ? edf_pick(engine) + offset : 0;
+
+        //the server wins ties, as the lowest index does everywhere else
+        bool serve = serverEligible(server, i) && ss_deadline(server) <= edf_earliestDeadline(engine);
+        if (serve) index = 0;
+
+        flags = dispatchSlot(ts, index);
+        if (flags) return flags;
+
+        if (serve) ss_consume(server);
+        else if (ready && ts.tasks[index].task->remainingCompTime == 0) edf_retire(engine);
+    }
+
+    //no release or deadline is ever behind the current slot, so the next round can start back at slot 0
+    edf_rebase(engine, hyperperiod);
+    if (server) ss_rebase(server, hyperperiod);
+
+    return 0x0000;
+}
+
+//number of engine priority levels above the sporadic server, 0 without one
+//the server keeps task 0's place in the priority order, ahead of any task it ties with
+static uint8_t serverLevelFP(PeriodicTaskSet ts, FixedPriority* engine, SporadicServer* server) {
+    PeriodicTaskSet periodic = engineTasks(ts, server);
+    uint8_t level = 0;
+    uint8_t i;
+    for (i = 0; server && i < periodic.size; i++) {
+        uint32_t key = engine->deadlineMonotonic ? periodic.tasks[i].deadline : periodic.tasks[i].period;
+        uint32_t serverKey = engine->deadlineMonotonic ? ts.tasks[0].deadline : ts.tasks[0].period;
+        if (key < serverKey) level++;
+    }
+    return level;
+}
+
+//dispatches a single hyperperiod by fixed priority
+static runFlag_t runHyperperiodFP(FixedPriority* engine, SporadicServer* server, uint32_t hyperperiod) {
+    PeriodicTaskSet ts = liveTasks;
+    PeriodicTaskSet periodic = engineTasks(ts, server);
+    uint8_t serverLevel = serverLevelFP(ts, engine, server);
+    uint8_t offset = server ? 1 : 0;
+    uint32_t i;
+    for (i = 0; i < hyperperiod; i++) {
+        runFlag_t flags;
+        if (changesWaiting()) {
+            if ((flags = changeOnline(NULL, engine, server, i))) return flags;
+            ts = liveTasks;
+            periodic = engineTasks(ts, server);
+            serverLevel = serverLevelFP(ts, engine, server);
         }
 
-        //if task has run out of remainingCompTime but function did not finish, indicate that the task was not assigned enough time
-        if (currentTask->task->remainingCompTime == 0 && !(flags & FLAG_FINISHED)) {
-            return stopRun(FLAG_INSUFFICIENT_COMPTIME | (currentTaskIndex << 8), schedule);
+        flags = fp_release(engine, periodic, i);
+        if (flags) return flags + (offset << 8);
+
+        //with nothing ready, index 0 has no comptime left so dispatchSlot() runs the aperiodic server
+        int8_t level = fp_pick(engine);
+        uint8_t index = level < 0 ? 0 : engine->order[level] + offset;
+
+        bool serve = serverEligible(server, i) && (level < 0 || level >= serverLevel);
+        if (serve) index = 0;
+
+        flags = dispatchSlot(ts, index);
+        if (flags) return flags;
+
+        if (serve) ss_consume(server);
+        else if (level >= 0 && ts.tasks[index].task->remainingCompTime == 0) fp_retire(engine, level);
+    }
+
+    fp_rebase(engine, hyperperiod);
+    if (server) ss_rebase(server, hyperperiod);
+
+    return 0x0000;
+}
+
+//number of slots the table-free engines dispatch per round before rebasing
+//the engines have no table to fit in memory, so only an overflowing hyperperiod matters
+//in that case just rebase as late as possible
+static uint32_t roundLength(PeriodicTaskSet ts) {
+    uint32_t hyperperiod;
+    if (!leastCommonMultiple(ts, &hyperperiod)) hyperperiod = UINT32_MAX;
+    return hyperperiod;
+}
+
+//ends a run. changes still waiting are applied so sched_taskSet() has them
+static runFlag_t endRun(runFlag_t flags) {
+    stopSlots(flags);
+    settleChanges();
+    activeParams = NULL;
+    return flags;
+}
+
+//the table for the running set. a set that is one of the modes has its table already
+static PeriodicSchedule* liveSchedule(runFlag_t* error) {
+    uint8_t m, i;
+    for (m = 0; m < SCHED_MAX_MODES; m++) {
+        PeriodicTaskSet mode = modes[m].tasks;
+        if (!modes[m].schedule || mode.size != liveTasks.size) continue;
+
+        for (i = 0; i < mode.size && samePeriodic(&(mode.tasks[i]), &(liveTasks.tasks[i])); i++) { }
+        if (i == mode.size) return modes[m].schedule;
+    }
+
+    return getSchedule(liveTasks, error);
+}
+
+//true if every job of the task is released and due within its own period
+//a period of 0 came from a period shorter than one slot
+static bool timingFits(const PeriodicTask* pt, uint32_t deadline, uint32_t offset) {
+    return pt->period && deadline && deadline <= pt->period && offset <= pt->period - deadline;
+}
+
+//checks what run() and sched_defineMode() are given
+//a task without a Task struct came from a fill or new call that ran out of pool space
+static runFlag_t checkTasks(PeriodicTaskSet ts) {
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        if (!ts.tasks[i].task) return FLAG_ALLOC_ERROR | (i << 8);
+        if (!timingFits(&(ts.tasks[i]), ts.tasks[i].deadline, ts.tasks[i].offset)) return FLAG_SCHEDULE_ERROR | (i << 8);
+    }
+    return ts.size > SCHED_MAX_PERIODIC ? FLAG_SCHEDULE_ERROR : 0x0000;
+}
+
+runFlag_t run(SchedParams params) {
+    runFlag_t flags;
+    uint8_t i;
+
+    if ((flags = checkTasks(params.tasks))) return flags;
+
+    //dispatching works on a copy, which admitPeriodic(), retirePeriodic() and requestMode() change as it runs
+    if (params.tasks.tasks != liveStorage) {
+        liveTasks.size = 0;
+        for (i = 0; i < params.tasks.size; i++) liveStorage[liveTasks.size++] = params.tasks.tasks[i];
+    }
+    dropChanges();
+    modeRequest = -1;
+    PeriodicTaskSet ts = liveTasks;
+
+    //there is a stack for every periodic task, but only when they are compiled in
+#if SCHED_PREEMPTIVE
+    preemptiveRun = params.preemptive;
+#else
+    if (params.preemptive) return FLAG_SCHEDULE_ERROR;
+#endif
+
+    //the sporadic server takes its budget and period from task 0, which the feasibility tests treat as periodic
+    static SporadicServer sporadicServer;
+    SporadicServer* server = NULL;
+    if (params.server == SERVER_SPORADIC) {
+        if (params.policy == POLICY_EDF_TABLE || ts.size == 0) return FLAG_SCHEDULE_ERROR;
+        server = &sporadicServer;
+        ss_init(server, ts.tasks[0].task->compTime, ts.tasks[0].period);
+    }
+
+    //slack stealing needs the table to know which slots are free ahead of time
+    static SlackStealer slackStealer;
+    SlackStealer* stealer = NULL;
+    if (params.server == SERVER_SLACK_STEALING) {
+        if (params.policy != POLICY_EDF_TABLE || !slack_init(&slackStealer, ts)) return FLAG_SCHEDULE_ERROR;
+        stealer = &slackStealer;
+    }
+
+    if (params.policy == POLICY_RM || params.policy == POLICY_DM) {
+        static FixedPriority engine;
+        bool deadlineMonotonic = params.policy == POLICY_DM;
+
+        if (!checkFeasibilityFP(ts, deadlineMonotonic, NULL) || !fp_init(&engine, engineTasks(ts, server), deadlineMonotonic)) {
+            return FLAG_SCHEDULE_ERROR;
         }
 
-        //if task has NOT run out of remainingCompTime but function DID finish, set task's remainingCompTime to zero.
-        //we will schedule the aperiodic server in its place
-        if (currentTask->task->remainingCompTime > 0 && flags & FLAG_FINISHED) {
-            currentTask->task->remainingCompTime = 0;
+        activeParams = &params;
+        startSlots();
+        do {
+            flags = runHyperperiodFP(&engine, server, roundLength(liveTasks));
+        } while (params.continuous && !(flags & (FLAG_EXIT | ERROR_FLAGS)));
+
+        return endRun(flags);
+    }
+
+    if (params.policy == POLICY_EDF_ONLINE) {
+        static OnlineEDF engine;
+
+        if (!checkFeasibilityEDF(ts, NULL) || !edf_init(&engine, engineTasks(ts, server))) {
+            return FLAG_SCHEDULE_ERROR;
         }
+
+        activeParams = &params;
+        startSlots();
+        do {
+            flags = runHyperperiodOnline(&engine, server, roundLength(liveTasks));
+        } while (params.continuous && !(flags & (FLAG_EXIT | ERROR_FLAGS)));
+
+        return endRun(flags);
     }
 
-    return stopRun(0x0000, schedule);
+    PeriodicSchedule* schedule = liveSchedule(&flags);
+    if (!schedule) return flags;
+
+    //in continuous mode the next hyperperiod starts straight from the cached schedule
+    //a changed task set gets a new one at the boundary, where no job is in flight
+    activeParams = &params;
+    startSlots();
+    do {
+        flags = runHyperperiod(liveTasks, schedule, stealer);
+
+        if (params.continuous && !(flags & (FLAG_EXIT | ERROR_FLAGS)) && changesWaiting()) {
+            settleChanges();
+            schedule = liveSchedule(&flags);
+            if (schedule && stealer && !slack_init(stealer, liveTasks)) flags = FLAG_SCHEDULE_ERROR;
+        }
+    } while (params.continuous && !(flags & (FLAG_EXIT | ERROR_FLAGS)));
+
+    return stopRun(endRun(flags), schedule);
 }
 
 runFlag_t stopRun(runFlag_t flags, PeriodicSchedule* schedule) {
-    freePeriodicSchedule(schedule);
+    //the schedule belongs to the cache and is reused by the next call to run()
+    //call invalidateSchedule() to release it
+    (void)schedule;
     return flags;
 }
 
+//appends one slot of the given task to the schedule at the top of the run arena, extending its last run where possible
+static bool appendSlot(PeriodicSchedule* s, uint8_t index) {
+    if (s->runCount) {
+        ScheduleRun* last = &(s->runs[s->runCount - 1]);
+        if (last->index == index && last->length < SCHEDULE_RUN_MAX) {
+            last->length++;
+            return true;
+        }
+    }
+
+    if (runTop == SCHED_MAX_SCHEDULE_RUNS) return false;
+
+    runStorage[runTop].index = index;
+    runStorage[runTop].length = 1;
+    runTop++;
+    if (runTop > runHighWater) runHighWater = runTop;
+    s->runCount++;
+    return true;
+}
+
 PeriodicSchedule* buildScheduleEDF(PeriodicTaskSet ts) {
-    uint32_t lcm = leastCommonMultiple(ts);
-    PeriodicSchedule* container = (PeriodicSchedule*)malloc(sizeof(PeriodicSchedule));
+    runFlag_t error;
+    return buildSchedule(ts, &error);
+}
+
+static PeriodicSchedule* buildSchedule(PeriodicTaskSet ts, runFlag_t* error) {
+    static uint32_t deadlines[SCHED_MAX_PERIODIC]; //absolute deadline of each task's current job
+    uint32_t lcm;
+    bool offsets = false;
+    uint8_t j;
+    *error = FLAG_SCHEDULE_ERROR;
+    if (ts.size > SCHED_MAX_PERIODIC || !leastCommonMultiple(ts, &lcm) || lcm > SCHED_MAX_HYPERPERIOD) return NULL;
+
+    for (j = 0; j < ts.size; j++) {
+        if (!timingFits(&(ts.tasks[j]), ts.tasks[j].deadline, ts.tasks[j].offset)) return NULL;
+        if (ts.tasks[j].offset) offsets = true;
+    }
+
+    //reject infeasible task sets before allocating anything
+    //the test assumes every task releases at slot 0, so a set with offsets may be feasible anyway. the simulation decides
+    if (!offsets && !checkFeasibilityEDF(ts, NULL)) return NULL;
+
+    PeriodicSchedule* container = (PeriodicSchedule*)pool_alloc(&schedulePool);
+    if (!container) {
+        *error = FLAG_ALLOC_ERROR;
+        return NULL;
+    }
     container->size = lcm;
-    uint8_t* schedule = (uint8_t*)malloc(sizeof(uint8_t) * lcm);
+    container->runCount = 0;
+    container->runs = runStorage + runTop;
     PeriodicTask* tasks = ts.tasks;
+
+    //no job is released before its offset
+    for (j = 0; j < ts.size; j++) tasks[j].task->remainingCompTime = 0;
+
     uint32_t i;
     for (i = 0; i < lcm; i++) {
-        uint8_t j;
         uint8_t currentTask = 0;
+        bool ready = false;
         for (j = 0; j < ts.size; j++) {
-            PeriodicTask thisTask = tasks[j];
+            Task* thisTask = tasks[j].task;
 
-            //if we have hit a multiple of the task's period, refill remaining computation time and set its deadline
-            if (i % thisTask.period == 0) {
-                //if the task wasn't fully allocated, the schedule is impossible. return null
-                if (thisTask.task->remainingCompTime > 0 && i != 0) {
-                    return NULL;
-                }
-                thisTask.task->remainingCompTime = thisTask.task->compTime;
-                thisTask.deadline = i + thisTask.period;
+            //if the task wasn't fully allocated by its deadline, the schedule is impossible. return null
+            if (thisTask->remainingCompTime > 0 && deadlines[j] <= i) {
+                freePeriodicSchedule(container);
+                return NULL;
+            }
+
+            //if we have hit the start of the task's period, refill remaining computation time and set its deadline
+            if (i % tasks[j].period == tasks[j].offset) {
+                thisTask->remainingCompTime = thisTask->compTime;
+                deadlines[j] = i + tasks[j].deadline;
             }
 
             //if task has no more computation time remaining, continue
-            if (thisTask.task->remainingCompTime <= 0) {
+            if (thisTask->remainingCompTime == 0) {
                 continue;
             }
 
             //else, if task is closer to its deadline than the current task, set current task to it
-            if (thisTask.deadline - i < tasks[currentTask].deadline - i || (currentTask == 0 && tasks[currentTask].task->remainingCompTime <= 0)) {
+            //ties go to the lower index
+            if (!ready || deadlines[j] < deadlines[currentTask]) {
                 currentTask = j;
+                ready = true;
             }
         }
 
         //task 0 will be run as default if all are cleared so make task 0 the aperiodic server for best results
 
-        schedule[i] = currentTask; //add the chosen task to schedule
+        //add the chosen task to schedule
+        if (!appendSlot(container, currentTask)) {
+            freePeriodicSchedule(container);
+            *error = FLAG_ALLOC_ERROR;
+            return NULL;
+        }
 
         //we have scheduled the task for this time slot so decrement its remaining time
         if (tasks[currentTask].task->remainingCompTime > 0) tasks[currentTask].task->remainingCompTime--;
     }
 
-    container->indices = schedule;
+    //every job is due by the end of the hyperperiod, so the table can simply repeat
+    for (j = 0; j < ts.size; j++) {
+        if (tasks[j].task->remainingCompTime > 0) {
+            freePeriodicSchedule(container);
+            return NULL;
+        }
+    }
+
+    *error = 0x0000;
     return container;
 }
 
+Task* sched_currentTask(void) {
+    return callingTask;
+}
+
+uint32_t sched_overruns(void) {
+    return overruns;
+}
+
+uint64_t sched_idleMicros(void) {
+    return idleMicros;
+}
+
+#if SCHED_PROFILE
+const TaskStats* sched_aperiodicStats(void) {
+    return &aperiodicStats;
+}
+#endif
+
 void aperiodicServer(taskFuncFlag_t* flags) {
-    Task* currentTask = aperListPeek(&aperList);
+    AperJob* job = aperQueue_peek(&aperQueue);
     taskFuncFlag_t aperFlags = 0;
 
-    if (currentTask == NULL) return; //if there are aperiodic tasks, we yield
+    //the server itself never needs more compTime than it is given
+    *flags |= FLAG_FINISHED;
 
-    //while a millisecond has not yet passed
-    while (timer_getMillis() < 1) {
+    //if there are no aperiodic tasks, we yield and let the core sleep until one is posted or the slot ends
+    if (job == NULL) {
+        *flags |= FLAG_IDLE;
+        return;
+    }
 
-        //if current task's remainingCompTime is equal to its compTime then it is new
-        if (currentTask->remainingCompTime == currentTask->compTime) {
-            aperFlags |= FLAG_RESET; //prepare reset flag
-        }
+    //a job that has not been run yet is new. taking one off its remainingCompTime marks it as started
+    if (job->remainingCompTime == job->compTime) {
+        aperFlags |= FLAG_RESET; //prepare reset flag
+        job->remainingCompTime--;
+        trace_event(TRACE_APER_START, 0);
+    }
 
-        //run function
-        currentTask->function(&aperFlags);
+#if SCHED_PROFILE
+    unsigned int call_start = timer_getMicros();
+#endif
 
-        aperFlags &= ~FLAG_RESET; // clear reset flag
+    //run function once. run() keeps calling the server until the slot is over
+    aperiodicTask.function = job->function;
+    aperiodicTask.compTime = job->compTime;
+    aperiodicTask.remainingCompTime = job->remainingCompTime;
+    callingTask = &aperiodicTask;
+    job->function(&aperFlags);
+    job->remainingCompTime = aperiodicTask.remainingCompTime;
 
-    }
+#if SCHED_PROFILE
+    unsigned int call_end = timer_getMicros();
+    profile_call(&aperiodicStats, &(job->profile), call_start, call_end);
+    if (aperFlags & FLAG_FINISHED) profile_finish(&aperiodicStats, &(job->profile), call_end);
+#endif
 
     // if function finished
     if (aperFlags & FLAG_FINISHED) {
-        // remove it from the queue and free its memory
-        aperListDequeue(&aperList);
-        freeTask(currentTask);
+        // remove it from the queue, which frees its slot
+        aperQueue_pop(&aperQueue);
+        trace_event(TRACE_APER_DONE, 0);
     }
 }
 
 PeriodicTask* newPeriodicTask(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t period) {
-    PeriodicTask* pt = (PeriodicTask*)malloc(sizeof(PeriodicTask));
-    
-    fillPeriodicTask(pt, taskFunction, compTime, period);
+    PeriodicTask* pt = (PeriodicTask*)pool_alloc(&periodicPool);
+    if (!pt) return NULL;
+
+    if (fillPeriodicTask(pt, taskFunction, compTime, period)) {
+        pool_free(&periodicPool, pt);
+        return NULL;
+    }
 
     return pt;
 }
 
-void fillPeriodicTask(PeriodicTask* task, void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t period) {
+runFlag_t fillPeriodicTask(PeriodicTask* task, void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t period) {
     task->task = newTask(taskFunction, compTime);
     task->period = period;
     task->deadline = period;
+    task->offset = 0;
+
+    return task->task ? 0x0000 : FLAG_ALLOC_ERROR;
+}
+
+PeriodicTask* newPeriodicTaskMicros(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compMicros, uint32_t periodMicros) {
+    uint32_t compTime = (compMicros + SCHED_QUANTUM_US - 1) / SCHED_QUANTUM_US;
+    return newPeriodicTask(taskFunction, compTime, periodMicros / SCHED_QUANTUM_US);
+}
+
+runFlag_t fillPeriodicTaskMicros(PeriodicTask* task, void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compMicros, uint32_t periodMicros) {
+    uint32_t compTime = (compMicros + SCHED_QUANTUM_US - 1) / SCHED_QUANTUM_US;
+    return fillPeriodicTask(task, taskFunction, compTime, periodMicros / SCHED_QUANTUM_US);
+}
+
+runFlag_t setPeriodicTiming(PeriodicTask* task, uint32_t deadline, uint32_t offset) {
+    if (!timingFits(task, deadline, offset)) return FLAG_SCHEDULE_ERROR;
+
+    task->deadline = deadline;
+    task->offset = offset;
+    return 0x0000;
+}
+
+runFlag_t setPeriodicTimingMicros(PeriodicTask* task, uint32_t deadlineMicros, uint32_t offsetMicros) {
+    return setPeriodicTiming(task, deadlineMicros / SCHED_QUANTUM_US, offsetMicros / SCHED_QUANTUM_US);
 }
 
 Task* newTask(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime) { //amogus
-    Task* task = (Task*)malloc(sizeof(Task));
+    Task* task = (Task*)pool_alloc(&taskPool);
+    if (!task) return NULL;
+
     task->function = taskFunction;
     task->compTime = compTime;
     task->remainingCompTime = compTime;
+    profile_reset(&(task->stats));
 
     return task;
 }
 
-void addAperiodic(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime) {
-    Task* t = newTask(taskFunction, compTime);
+runFlag_t admitPeriodic(const PeriodicTask* task) {
+    if (!activeParams || activeParams->preemptive || !task->task || !timingFits(task, task->deadline, task->offset)) {
+        return FLAG_SCHEDULE_ERROR;
+    }
+    if (liveTasks.size + admissionCount >= SCHED_MAX_PERIODIC || admissionCount >= SCHED_MAX_ADMISSIONS) return FLAG_ALLOC_ERROR;
+
+    //the set as it will be once everything waiting is in, with the tasks still retiring
+    static PeriodicTask candidates[SCHED_MAX_PERIODIC];
+    PeriodicTaskSet candidate = { candidates, 0 };
+    uint8_t i;
+    for (i = 0; i < liveTasks.size; i++) candidates[candidate.size++] = liveTasks.tasks[i];
+    for (i = 0; i < admissionCount; i++) candidates[candidate.size++] = admissions[i];
 
-    AperListNode* tail = aperList.tail;
-    AperListNode* new = (AperListNode*)malloc(sizeof(AperListNode));
-    new->task = t;
-    new->next = NULL;
-    if (tail) tail->next = new;
-    else aperList.head = new;
-    aperList.tail = new;
-    aperList.count++;
-}
+    //one Task can only be dispatched as one task
+    for (i = 0; i < candidate.size; i++) {
+        if (candidates[i].task == task->task) return FLAG_SCHEDULE_ERROR;
+    }
+    candidates[candidate.size++] = *task;
 
-void freeTask(Task* t) {
-    free(t);
+    bool feasible;
+    if (activeParams->policy == POLICY_RM || activeParams->policy == POLICY_DM) {
+        feasible = checkFeasibilityFP(candidate, activeParams->policy == POLICY_DM, NULL);
+    }
+    else {
+        feasible = checkFeasibilityEDF(candidate, NULL);
+    }
+    if (!feasible) return FLAG_SCHEDULE_ERROR;
+
+    admissions[admissionCount++] = *task;
+    return 0x0000;
 }
 
-void freePeriodicTask(PeriodicTask* t) {
-    freeTask(t->task);
-    free(t);
+runFlag_t retirePeriodic(const Task* task) {
+    if (!activeParams || activeParams->preemptive) return FLAG_SCHEDULE_ERROR;
+
+    uint8_t i;
+    for (i = 0; i < admissionCount; i++) {
+        //not taken in yet, so it is simply withdrawn
+        if (admissions[i].task == task) {
+            admissionCount--;
+            for (; i < admissionCount; i++) admissions[i] = admissions[i + 1];
+            return 0x0000;
+        }
+    }
+
+    //task 0 is not looked for, it stays for as long as the run does
+    for (i = 1; i < liveTasks.size; i++) {
+        if (liveTasks.tasks[i].task == task) {
+            if (!retiring[i]) retiringCount++;
+            retiring[i] = true;
+            return 0x0000;
+        }
+    }
+
+    return FLAG_SCHEDULE_ERROR;
 }
 
-void freePeriodicSchedule(PeriodicSchedule* s) {
-    free(s->indices);
-    free(s);
+runFlag_t sched_defineMode(uint8_t mode, PeriodicTaskSet ts) {
+    if (mode >= SCHED_MAX_MODES || activeParams || !ts.size) return FLAG_SCHEDULE_ERROR;
+
+    runFlag_t flags = checkTasks(ts);
+    if (flags) return flags;
+    if (!checkFeasibilityEDF(ts, NULL)) return FLAG_SCHEDULE_ERROR;
+
+    //build before letting go of the old table, so a mode that can not get a new one keeps what it had
+    PeriodicSchedule* schedule = buildSchedule(ts, &flags);
+    if (flags == FLAG_ALLOC_ERROR) return flags;
+
+    SchedMode* m = &(modes[mode]);
+    if (m->schedule) freePeriodicSchedule(m->schedule);
+    m->tasks = ts;
+    m->schedule = schedule;
+    m->defined = true;
+
+    return 0x0000;
 }
 
-void freePeriodicTaskSet(PeriodicTaskSet* ts) {
-    uint8_t i;
-    for (i = 0; i < ts->size; i++) {
-        freePeriodicTask(ts->tasks + i);
-        free(ts->tasks);
+runFlag_t requestMode(uint8_t mode) {
+    if (!activeParams || activeParams->preemptive || mode >= SCHED_MAX_MODES || !modes[mode].defined) return FLAG_SCHEDULE_ERROR;
+
+    PeriodicTaskSet next = modes[mode].tasks;
+    if (next.tasks[0].task != liveTasks.tasks[0].task) return FLAG_SCHEDULE_ERROR;
+
+    //every mode passed the EDF test when it was defined
+    SchedPolicy policy = activeParams->policy;
+    if (policy == POLICY_EDF_TABLE && !modes[mode].schedule) return FLAG_SCHEDULE_ERROR;
+    if ((policy == POLICY_RM || policy == POLICY_DM) && !checkFeasibilityFP(next, policy == POLICY_DM, NULL)) {
+        return FLAG_SCHEDULE_ERROR;
     }
-    free(ts);
+
+    modeRequest = mode;
+    return 0x0000;
+}
+
+int8_t sched_mode(void) {
+    return currentMode;
+}
+
+PeriodicTaskSet sched_taskSet(void) {
+    return liveTasks;
 }
 
-void freeAperList(AperList* list) {
-    while (aperListDequeue(list)) { }
-    free(list);
+runFlag_t addAperiodic(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime) {
+    return addAperiodicJob(taskFunction, compTime, 0, 0);
 }
 
-Task* aperListDequeue(AperList* list) {
-    AperListNode* head = list->head;
+//queues a job with compTime in slots and a relative deadline in microseconds, 0 for none
+static runFlag_t postAperiodic(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t deadlineMicros, uint8_t priority) {
+    //every job takes at least one slot, which also lets the server tell started jobs from new ones
+    if (compTime == 0) compTime = 1;
+
+    uint32_t now = timer_getMicros();
+    bool hasDeadline = deadlineMicros > 0;
+
+    trace_event(TRACE_APER_POST, aperQueue_count(&aperQueue));
 
-    if (!head) return NULL;
+    return aperQueue_post(&aperQueue, taskFunction, compTime, hasDeadline, now + deadlineMicros, priority, now) ? 0x0000 : FLAG_ALLOC_ERROR;
+}
 
-    if (head == list->tail) list->tail = NULL;
-    list->head = head->next;
+runFlag_t addAperiodicJob(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t deadline, uint8_t priority) {
+    return postAperiodic(taskFunction, compTime, deadline * SCHED_QUANTUM_US, priority);
+}
 
-    Task* t = head->task;
+runFlag_t addAperiodicJobMicros(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compMicros, uint32_t deadlineMicros, uint8_t priority) {
+    uint32_t compTime = (compMicros + SCHED_QUANTUM_US - 1) / SCHED_QUANTUM_US;
+    return postAperiodic(taskFunction, compTime, deadlineMicros, priority);
+}
 
-    free(head);
+void freeTask(Task* t) {
+    pool_free(&taskPool, t);
+}
 
-    list->count--;
+void freePeriodicTask(PeriodicTask* t) {
+    freeTask(t->task);
+    pool_free(&periodicPool, t);
+}
+
+//removes a schedule's runs from the arena, moving the runs above them down and pointing their schedules at the new place
+static void releaseRuns(PeriodicSchedule* s) {
+    if (!s->runs || !s->runCount) return;
+
+    uint32_t start = (uint32_t)(s->runs - runStorage);
+    uint32_t end = start + s->runCount;
+    uint32_t i;
+    for (i = end; i < runTop; i++) runStorage[i - s->runCount] = runStorage[i];
+    runTop -= s->runCount;
+
+    //freed schedules have their runs cleared, so only the live schedules above this one move
+    for (i = 0; i < SCHED_MAX_SCHEDULES; i++) {
+        PeriodicSchedule* other = &(scheduleStorage[i]);
+        if (other->runs && other->runs >= runStorage + end) other->runs -= s->runCount;
+    }
+}
+
+void freePeriodicSchedule(PeriodicSchedule* s) {
+    if (!pool_owns(&schedulePool, s)) return;
+
+    releaseRuns(s);
+    s->runs = NULL;
+    s->runCount = 0;
+    pool_free(&schedulePool, s);
+}
+
+void freePeriodicTaskSet(PeriodicTaskSet* ts) {
+    uint8_t i;
+    for (i = 0; i < ts->size; i++) {
+        freeTask(ts->tasks[i].task);
+        ts->tasks[i].task = NULL;
+    }
+}
 
-    return t;
+static void usage(PoolUsage* u, const Pool* p) {
+    u->used = p->used;
+    u->highWater = p->highWater;
+    u->capacity = p->capacity;
 }
 
-Task* aperListPeek(AperList* list) {
-    return list->head->task;
+void sched_memoryReport(SchedMemoryReport* report) {
+    usage(&report->tasks, &taskPool);
+    usage(&report->periodicTasks, &periodicPool);
+    report->aperiodicJobs.used = aperQueue_count(&aperQueue);
+    report->aperiodicJobs.highWater = aperQueue.highWater;
+    report->aperiodicJobs.capacity = SCHED_MAX_APERIODIC;
+    usage(&report->schedules, &schedulePool);
+    report->scheduleRuns.used = runTop;
+    report->scheduleRuns.highWater = runHighWater;
+    report->scheduleRuns.capacity = SCHED_MAX_SCHEDULE_RUNS;
 }
@@ -5,8 +5,13 @@
  *      Author: winter
  *
  *  a task function should "yield" its time with a return statement whenever it is able to
- *  it must also be able to resume where it left off when called again
+ *  it must also be able to resume where it left off when called again. the macros in Coroutine.h keep track of that
+ *  in a preemptive run, see SCHED_PREEMPTIVE, periodic tasks other than task 0 may instead block like ordinary code
+ *  run() uses TIMER4 for the slot tick, so the timer_fire functions are not available to tasks while it runs
  */
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -20,14 +25,18 @@
  * bit 2    0 - task has not indicated that the program should terminate
  *          1 - task has indicated that the program should terminate
  *
- * bit 3:7  unused
+ * bit 3    0 - task may have more work this slot
+ *          1 - task has nothing to do until an interrupt, the core may sleep until then
+ *
+ * bit 4:7  unused
  */
 typedef uint8_t taskFuncFlag_t; //typedef for greater clarity when a uint8_t is used as a string of flags
 #define FLAG_RESET 0x01 //pass-in flag for when task function should reset itself
 #define FLAG_FINISHED 0x02 //pass-back flag for when task has finished
 #define FLAG_EXIT 0x0004 //task is indicating that the program should terminate
+#define FLAG_IDLE 0x08 //pass-back flag for when task has nothing to do until an interrupt
 
-#define ERROR_FLAGS 0x0003 //a combination of all flags that indicate an error state
+#define ERROR_FLAGS 0x007B //a combination of all flags that indicate an error state
 
 /*
  * bit 0    0 - functions yielded often enough
@@ -39,28 +48,158 @@ typedef uint8_t taskFuncFlag_t; //typedef for greater clarity when a uint8_t is
  * bit 2    0 - task has not indicated that the program should terminate
  *          1 - task has indicated that the program should terminate
  *
- * bit 3:7  unused
+ * bit 3    0 - every job met its deadline
+ *          1 - deadline miss. a job was still unfinished at its deadline
+ *
+ * bit 4    0 - a schedule was built for the task set
+ *          1 - schedule error. no schedule could be built for the task set
+ *
+ * bit 5    0 - every allocation succeeded
+ *          1 - allocation error. a static pool ran out of space, see SCHED_MAX_*
+ *
+ * bit 6    0 - every preemptive task stayed within its stack
+ *          1 - stack overflow. a preemptive task wrote into the guard at the bottom of its stack
+ *
+ * bit 7    unused
  *
  * bit 8:15 stores the 8-bit unsigned index of the task that raised the other flag(s)
  */
 typedef uint16_t runFlag_t; //flag to be used by run()
 #define FLAG_YIELD_ERROR 0x0001 //a task did not yield often enough
 #define FLAG_INSUFFICIENT_COMPTIME 0x0002 //a task did not complete in the comptime it was assigned
+#define FLAG_DEADLINE_MISS 0x0008 //a job did not get all of its comptime before its deadline
+#define FLAG_SCHEDULE_ERROR 0x0010 //the task set could not be scheduled
+#define FLAG_ALLOC_ERROR 0x0020 //a scheduler object could not be allocated
+#define FLAG_STACK_OVERFLOW 0x0040 //a preemptive task overflowed its stack, found after it was switched out
 #define FLAG_TASKINDEX 0xFF00 //bits 15:8 store the task index that caused the issue
 //FLAG_EXIT and ERROR_FLAGS are also relevant in runFlag_t
 
+/*
+ * every scheduler object comes from a statically sized pool, the heap is never used
+ * these are the pool sizes. override any of them at compile time
+ */
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 32 //Task structs, shared by periodic and aperiodic tasks
+#endif
+#ifndef SCHED_MAX_PERIODIC
+#define SCHED_MAX_PERIODIC 16 //PeriodicTask structs from newPeriodicTask(), also the largest task set run() takes
+#endif
+#ifndef SCHED_MAX_APERIODIC
+#define SCHED_MAX_APERIODIC 16 //queued aperiodic jobs, must be a power of two
+#endif
+#ifndef SCHED_MAX_MODES
+#define SCHED_MAX_MODES 4 //task sets defined with sched_defineMode()
+#endif
+#ifndef SCHED_MAX_SCHEDULES
+#define SCHED_MAX_SCHEDULES (2 + SCHED_MAX_MODES) //PeriodicSchedule structs alive at once, one is kept per mode
+#endif
+#ifndef SCHED_MAX_SCHEDULE_RUNS
+#define SCHED_MAX_SCHEDULE_RUNS 1024 //ScheduleRun entries shared by every live schedule
+#endif
+#ifndef SCHED_MAX_ADMISSIONS
+#define SCHED_MAX_ADMISSIONS 4 //admitPeriodic() calls waiting for the running schedule to take them in
+#endif
+
+/*
+ * timing. compTime, period and deadline are all counted in slots of SCHED_QUANTUM_US
+ * a shorter quantum wastes less of a slot on short jobs but takes a tick interrupt more often
+ */
+#ifndef SCHED_QUANTUM_US
+#define SCHED_QUANTUM_US 1000 //length of one time slot in microseconds
+#endif
+#ifndef SCHED_YIELD_LIMIT_US
+#define SCHED_YIELD_LIMIT_US (2 * SCHED_QUANTUM_US) //longest a single task call may run before a yield error
+#endif
+#if SCHED_YIELD_LIMIT_US < SCHED_QUANTUM_US
+#error "SCHED_YIELD_LIMIT_US must be at least one SCHED_QUANTUM_US"
+#endif
+
+/*
+ * preemptive execution. with SCHED_PREEMPTIVE set to 1, SchedParams.preemptive runs every periodic task except task 0
+ * on a stack of its own. such a task's function is called once per job and may block, the job ends when it returns
+ * the slot tick switches tasks, so there are no yield errors, and a job that is still running once its compTime is
+ * used up is abandoned (see sched_overruns()) instead of ending the run. task 0 and aperiodic jobs stay cooperative
+ * each stack costs SCHED_STACK_WORDS words of RAM, SCHED_MAX_PERIODIC - 1 of them, the lowest SCHED_STACK_GUARD_WORDS
+ * of each are a guard (see Context.h) that only reveals an overflow once the task has been switched out
+ */
+#ifndef SCHED_PREEMPTIVE
+#define SCHED_PREEMPTIVE 0
+#endif
+#ifndef SCHED_STACK_WORDS
+#ifdef SCHED_HOST
+#define SCHED_STACK_WORDS 8192 //libc on the host needs far more than a task does on the target
+#else
+#define SCHED_STACK_WORDS 256 //words per preemptive task stack, including room for one exception frame
+#endif
+#endif
+
+/*
+ * coroutines. every Task has room for the resume point and locals of a task function written with Coroutine.h
+ */
+#ifndef SCHED_CORO_LOCAL_WORDS
+#define SCHED_CORO_LOCAL_WORDS 4 //32-bit words of locals that a coroutine keeps between calls
+#endif
+
+/*
+ * profiling. every Task keeps execution time statistics, see TaskStats. costs one timer read per task call
+ * set SCHED_PROFILE to 0 to compile it out
+ */
+#ifndef SCHED_PROFILE
+#define SCHED_PROFILE 1
+#endif
+#ifndef SCHED_PROFILE_BUCKETS
+#define SCHED_PROFILE_BUCKETS 12 //log2 histogram buckets, the last one collects everything longer
+#endif
+
+//state of the job a task is currently running, used to build its TaskStats
+typedef struct {
+    uint32_t releasedAt; //timer_getMicros() when the job was released
+    uint32_t demand; //microseconds the job has run for so far
+    bool started; //the job has been called at least once
+    bool active; //the job was released and has not finished yet
+} JobProfile;
+
+//execution time statistics of a task, all times in microseconds
+typedef struct {
+    uint32_t calls; //task function invocations
+    uint32_t callMin;
+    uint32_t callMax;
+    uint64_t callTotal; //callTotal / calls is the mean time per invocation
+    uint32_t jobs; //jobs that finished
+    uint32_t demandMax; //most time one job needed in total, the measured WCET. size compTime from this
+    uint64_t demandTotal;
+    uint32_t startMin; //release to first call. startMax - startMin is the release jitter
+    uint32_t startMax;
+    uint32_t latencyMax; //release to finish, the response time
+    uint64_t latencyTotal;
+    uint32_t histogram[SCHED_PROFILE_BUCKETS]; //invocations by time, bucket k holds [2^k, 2^(k+1)), bucket 0 also holds 0
+    JobProfile job;
+} TaskStats;
+
+//where a coroutine task function left off, see Coroutine.h
+typedef struct {
+    uint16_t line; //resume point, 0 to start from the top
+    uint32_t since; //timer_getMicros() when the current CO_WAIT_MICROS() began
+    uint32_t locals[SCHED_CORO_LOCAL_WORDS]; //see CO_LOCALS()
+} CoState;
+
 //for representing a basic, generic task
 typedef struct {                                              //if true, only one task with this function is allowed
     void (*function)(taskFuncFlag_t* flags); //the function that actually represents the work to be done
     uint32_t compTime;                                          //computation time
     uint32_t remainingCompTime;                                 //remaining computation time
+    CoState coro; //only touched by Coroutine.h, FLAG_RESET starts it over
+#if SCHED_PROFILE
+    TaskStats stats; //measured by run() and aperiodicServer()
+#endif
 } Task;
 
 //for representing a periodic task
 typedef struct _PeriodicTask {
     Task* task; //nested basic task struct
     uint32_t period; //how often the task will recur
-    uint32_t deadline; //this is a multiple of period
+    uint32_t deadline; //slots after each release the job has to be finished by, at most period - offset
+    uint32_t offset; //slot of the first release, counted from when the task starts being dispatched
 } PeriodicTask;
 
 //for representing a set of tasks
@@ -69,38 +208,89 @@ typedef struct {
     uint8_t size; //number of periodic tasks
 } PeriodicTaskSet;
 
+//one run-length encoded stretch of a schedule: a task index and how many consecutive slots it holds
+//runs longer than SCHEDULE_RUN_MAX slots are split over several entries
+typedef struct {
+    uint8_t index; //the index of a corresponding task in the task set this was built from
+    uint8_t length; //the number of consecutive time slots given to that task
+} ScheduleRun;
+#define SCHEDULE_RUN_MAX 0xFF
+
+//longest hyperperiod, in slots, that buildScheduleEDF() will build a table for
+//task sets with a longer hyperperiod are rejected, use POLICY_EDF_ONLINE for those
+#ifndef SCHED_MAX_HYPERPERIOD
+#define SCHED_MAX_HYPERPERIOD 10000
+#endif
+
 //for representing a task schedule
 // NOTE: this stores indices which correspond to the task set it was built from
 // this was done for memory conservation as a pointer is 32 bits but an index is only 8 bits
-// this is important because this array may become large with a value for each time slot in a schedule
+// consecutive slots of the same task are stored as a single run, so a job that spans several slots
+// costs one 2-byte entry instead of one byte per slot
 // there are no empty time slots as the aperiodic server will fill any empty slots
 typedef struct {
-    uint8_t size; //the number of time slots
-    uint8_t* indices; //the index of a corresponding task in the task set this was built from
+    uint32_t size; //the number of time slots
+    uint32_t runCount; //the number of entries in runs
+    ScheduleRun* runs; //the schedule as consecutive runs of slots. moves down when an older schedule is freed
 } PeriodicSchedule;
 
+//how run() decides which periodic task gets each time slot
+typedef enum {
+    POLICY_EDF_TABLE = 0, //dispatch from a precomputed EDF schedule covering the whole hyperperiod
+    POLICY_EDF_ONLINE,    //make EDF decisions slot by slot, memory is O(n) instead of O(hyperperiod)
+    POLICY_RM,            //fixed priorities, shorter period runs first
+    POLICY_DM             //fixed priorities, shorter relative deadline runs first
+} SchedPolicy;
+
+//how the aperiodic server, task 0, is given its time
+typedef enum {
+    SERVER_POLLING = 0, //task 0 is an ordinary periodic task, budget it cannot use when released is lost
+    SERVER_SPORADIC,    //task 0's compTime is a budget kept until used and replenished one period after use
+                        //only supported by the table-free policies
+    SERVER_SLACK_STEALING //aperiodic jobs also take periodic slots whenever the table has slack to pay them back
+                          //only supported by POLICY_EDF_TABLE
+} SchedServer;
+
 //a set of parameters with which to run a cycle of the scheduler
 typedef struct {
     PeriodicTaskSet tasks; //task set to generate schedule from
+    SchedPolicy policy; //scheduling engine to dispatch with
+    SchedServer server; //aperiodic server mode
+    bool continuous; //if true, run() keeps dispatching hyperperiods until a task exits or an error occurs
+    bool preemptive; //run tasks 1..n-1 preemptively on their own stacks. needs SCHED_PREEMPTIVE, FLAG_SCHEDULE_ERROR otherwise
 } SchedParams;
 
-//node in a linked list queue data structure for aperiodic task management
-typedef struct _AperListNode {
-    struct _AperListNode* next;
-    Task* task;
-} AperListNode;
-
-typedef struct _AperList {
-    AperListNode* head;
-    AperListNode* tail;
-    uint8_t count;
-} AperList;
-
 //function to build a periodic schedule from a periodic task set
+//returns NULL if the task set cannot be scheduled, has more than SCHED_MAX_PERIODIC tasks,
+//or its hyperperiod overflows or exceeds SCHED_MAX_HYPERPERIOD
 PeriodicSchedule* buildScheduleEDF(PeriodicTaskSet);
 
+//returns the cached schedule for a task set, building it only if the task set changed since the last call
+//the returned schedule is owned by the cache, do not free it
+//on failure NULL is returned and error receives FLAG_SCHEDULE_ERROR or FLAG_ALLOC_ERROR
+PeriodicSchedule* getSchedule(PeriodicTaskSet, runFlag_t* error);
+
+//frees the cached schedule. the next call to run() or getSchedule() rebuilds it
+void invalidateSchedule(void);
+
+//task function serving queued aperiodic jobs, most urgent first. make it task 0 of the task set
+//each call runs the current job once and returns, so it yields as often as the job does
 void aperiodicServer(taskFuncFlag_t* flags);
 
+//microseconds the core has spent asleep in idle slots since sched_init()
+uint64_t sched_idleMicros(void);
+
+//the Task whose function the scheduler is calling. valid inside a task function only
+Task* sched_currentTask(void);
+
+//preemptive jobs abandoned since sched_init() because they used up their compTime without returning
+uint32_t sched_overruns(void);
+
+#if SCHED_PROFILE
+//statistics over every aperiodic job served, releases are the calls to addAperiodic()
+const TaskStats* sched_aperiodicStats(void);
+#endif
+
 //function to initialize this entire scheduler
 //CALL THIS FIRST
 void sched_init(void);
@@ -109,25 +299,127 @@ void sched_init(void);
 runFlag_t run(SchedParams params);
 runFlag_t stopRun(runFlag_t flags, PeriodicSchedule* schedule);
 
-//creates a new aperiodic task according to the specification and appends it to the linked list
-void addAperiodic(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t);
+/*
+ * changing the task set of a running run(), e.g. from a task function. neither call is safe from an ISR
+ * admitPeriodic() takes a copy of task into the set if the set, with task and with every earlier admission, passes the
+ * feasibility test of the run's policy. retirePeriodic() stops the periodic task using the given Task from releasing
+ * any more jobs. tasks waiting to leave still count against admissions, so the set stays feasible throughout
+ * changes take effect at the next point where no job in flight is disturbed:
+ *   POLICY_EDF_ONLINE, POLICY_RM and POLICY_DM update the engine in place. an admitted task releases its first job
+ *     its offset after the next slot, a retired task finishes its current job and leaves when its next one would have
+ *     been released
+ *   POLICY_EDF_TABLE swaps in a rebuilt table at the next hyperperiod boundary, offsets count from there
+ * run() works on its own copy of params.tasks, see sched_taskSet()
+ * both return FLAG_SCHEDULE_ERROR outside of a run, in a preemptive run, for task 0, for an unknown task or an
+ * infeasible set, and FLAG_ALLOC_ERROR if the set would grow past SCHED_MAX_PERIODIC or SCHED_MAX_ADMISSIONS are waiting
+ */
+runFlag_t admitPeriodic(const PeriodicTask* task);
+runFlag_t retirePeriodic(const Task* task);
+
+/*
+ * operating modes. each mode is a whole task set, defined up front so its EDF table is built before it is needed
+ * requestMode() asks a running run() to switch to another mode, e.g. from a task function, at a point where no
+ * deadline is put at risk:
+ *   POLICY_EDF_TABLE switches to the mode's precomputed table at the next hyperperiod boundary
+ *   POLICY_EDF_ONLINE, POLICY_RM and POLICY_DM switch at the first slot that starts with no job pending. tasks that are
+ *     in both modes, with the same Task, period, deadline and offset, keep their phase. the new ones release their
+ *     first job after their offset and the ones left behind are dropped
+ * the run goes on without stopping the slot tick. a mode replaces admissions and retirements still waiting
+ * every mode must share task 0 with the running set, the aperiodic server stays through a switch
+ */
+
+//defines mode as the given task set, which must stay valid while the mode is in use
+//returns FLAG_SCHEDULE_ERROR for a bad mode number, during a run, or if the set fails the EDF feasibility test
+//the table is built now. if the set has no table (its hyperperiod is too long, or EDF misses with its offsets), the mode
+//is still defined but POLICY_EDF_TABLE runs refuse it
+//returns FLAG_ALLOC_ERROR, leaving the mode as it was, if the schedule pools have no room for the table
+runFlag_t sched_defineMode(uint8_t mode, PeriodicTaskSet ts);
+
+//asks the running run() to switch to mode. a later request replaces one still waiting
+//returns FLAG_SCHEDULE_ERROR outside of a run, in a preemptive run, for an undefined mode, for a mode that does not
+//share task 0 or fails the policy's feasibility test, and for a table run if the mode has no table
+runFlag_t requestMode(uint8_t mode);
+
+//the mode the task set was last switched to, -1 if none since sched_init()
+int8_t sched_mode(void);
+
+//the task set the last run() dispatched, with the changes made while it ran applied
+//non-continuous callers pass it back as params.tasks to keep those changes in the next run()
+PeriodicTaskSet sched_taskSet(void);
+
+//queues a new aperiodic job according to the specification for the aperiodic server
+//constant time and lock-free, so it can be called from an ISR
+//returns FLAG_ALLOC_ERROR if the aperiodic queue is full
+runFlag_t addAperiodic(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t);
+
+//same as addAperiodic(), for a job with a relative deadline in slots (0 for none) and a priority
+//jobs are served earliest deadline first, jobs without a deadline after those with one,
+//then by higher priority, then in the order they were queued. addAperiodic() jobs have no deadline and priority 0
+//deadlines are kept as timer_getMicros() times, so they must be shorter than 2^31 microseconds
+runFlag_t addAperiodicJob(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t deadline, uint8_t priority);
+//same with compTime and deadline in microseconds. compTime is rounded up to whole slots like fillPeriodicTaskMicros(),
+//the deadline is kept as given
+runFlag_t addAperiodicJobMicros(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compMicros, uint32_t deadlineMicros, uint8_t priority);
 
 //creates and returns a new generic/aperiodic task according to the specification
+//returns NULL if the task pool is full
 Task* newTask(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t);
 
 //creates and returns a new periodic task according to the specification
+//returns NULL if the task pools are full
 PeriodicTask* newPeriodicTask(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t, uint32_t);
-void fillPeriodicTask(PeriodicTask* task, void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t period);
+//fills in a periodic task you allocated yourself. returns FLAG_ALLOC_ERROR if the task pool is full
+runFlag_t fillPeriodicTask(PeriodicTask* task, void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compTime, uint32_t period);
+
+//same as newPeriodicTask() and fillPeriodicTask() with compTime and period in microseconds
+//compTime is rounded up to whole slots and period down, so the task never gets less time or a later deadline than asked for
+//budgets are whole slots because the slot is the unit of dispatch: a slot belongs to one task until the tick, so when a
+//job finishes early the rest of its slot is not handed to another task. e.g. with 1000 us slots 1100 us of work
+//takes two slots, and the feasibility tests count both. shorten SCHED_QUANTUM_US to waste less on budgets like that
+//a period shorter than one slot leaves the period at 0, which run() rejects with FLAG_SCHEDULE_ERROR
+PeriodicTask* newPeriodicTaskMicros(void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compMicros, uint32_t periodMicros);
+runFlag_t fillPeriodicTaskMicros(PeriodicTask* task, void (*taskFunction)(taskFuncFlag_t* flags), uint32_t compMicros, uint32_t periodMicros);
+
+/*
+ * release timing. the new and fill calls give a task deadline == period and offset 0, these change that afterwards
+ * a shorter deadline tightens the latency from release to finish, an offset spreads releases so they do not all land
+ * in slot 0. a job has to be released and due within one period, so offset + deadline must not exceed period
+ * the feasibility tests check the synchronous case, all offsets at 0, which is the worst case, so offsets never make
+ * a set fail. only the table builder, which simulates the actual releases, accepts sets that need their offsets
+ * with a sporadic server, task 0's offset is ignored
+ */
+//returns FLAG_SCHEDULE_ERROR, leaving the task as it was, if the timing does not fit in the period
+runFlag_t setPeriodicTiming(PeriodicTask* task, uint32_t deadline, uint32_t offset);
+//same with deadline and offset in microseconds. both are rounded down, so a job is never due or released later than asked
+runFlag_t setPeriodicTimingMicros(PeriodicTask* task, uint32_t deadlineMicros, uint32_t offsetMicros);
+
+//usage of one of the static pools
+typedef struct {
+    uint32_t used; //currently allocated
+    uint32_t highWater; //most ever allocated at once
+    uint32_t capacity; //compile-time size
+} PoolUsage;
+
+//usage of every static pool the scheduler allocates from
+typedef struct {
+    PoolUsage tasks;
+    PoolUsage periodicTasks;
+    PoolUsage aperiodicJobs;
+    PoolUsage schedules;
+    PoolUsage scheduleRuns;
+} SchedMemoryReport;
+
+//fills in the current and high-water usage of every pool
+void sched_memoryReport(SchedMemoryReport* report);
 
 //for freeing the struct and all relevant members
 //you making use of this library only need to free what you directly allocated
 //everything the library allocates it is already set up to free
+//structs you allocated yourself (such as a task set array) are left alone, only what the library put in them is released
 void freeTask(Task*);
 void freePeriodicTaskSet(PeriodicTaskSet* ts);
-void freeAperList(AperList* list);
+//schedules may be freed in any order, the runs of the ones left are moved down to close the gap
 void freePeriodicSchedule(PeriodicSchedule* s);
 void freePeriodicTask(PeriodicTask* t);
 
-//dequeues a task from the aperiodic list
-Task* aperListDequeue(AperList*);
-Task* aperListPeek(AperList* list);
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,103 @@
+#include "SlackStealer.h"
+
+//absolute deadline of the job of the task at index that is in flight at slot
+//a job is released and due within one period, so its release is the last start of a period at or before slot
+static uint32_t jobDeadline(PeriodicTaskSet ts, uint8_t index, uint32_t slot) {
+    PeriodicTask* pt = &(ts.tasks[index]);
+    return slot - (slot - pt->offset) % pt->period + pt->deadline;
+}
+
+bool slack_init(SlackStealer* s, PeriodicTaskSet ts) {
+    if (ts.size > SCHED_MAX_PERIODIC) return false;
+
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        s->debt[i] = 0;
+        s->deadline[i] = 0;
+    }
+    s->totalDebt = 0;
+    s->count = ts.size;
+
+    return true;
+}
+
+uint32_t slack_freeSlots(const PeriodicSchedule* schedule, uint32_t run, uint32_t runStart, uint32_t slot, uint32_t until) {
+    uint32_t free = 0;
+    uint32_t start = runStart;
+
+    //only the runs between slot and until are visited, and until is never more than a period away
+    for (; run < schedule->runCount && start < until; run++) {
+        uint32_t end = start + schedule->runs[run].length;
+
+        if (schedule->runs[run].index == 0) {
+            uint32_t from = start > slot + 1 ? start : slot + 1;
+            uint32_t to = end < until ? end : until;
+            if (to > from) free += to - from;
+        }
+
+        start = end;
+    }
+
+    return free;
+}
+
+bool slack_canSteal(const SlackStealer* s, PeriodicTaskSet ts, const PeriodicSchedule* schedule,
+                    uint32_t run, uint32_t runStart, uint32_t slot, uint8_t victim) {
+    uint32_t owed = s->totalDebt;
+    uint32_t earliest = UINT32_MAX;
+
+    if (victim) {
+        owed++;
+        earliest = jobDeadline(ts, victim, slot);
+    }
+
+    if (!owed) return true;
+
+    //paying every debt before the earliest indebted deadline is enough for all of them
+    uint8_t i;
+    for (i = 1; i < s->count; i++) {
+        if (s->debt[i] && s->deadline[i] < earliest) earliest = s->deadline[i];
+    }
+
+    return owed <= slack_freeSlots(schedule, run, runStart, slot, earliest);
+}
+
+void slack_steal(SlackStealer* s, PeriodicTaskSet ts, uint8_t victim, uint32_t slot) {
+    s->deadline[victim] = jobDeadline(ts, victim, slot);
+    s->debt[victim]++;
+    s->totalDebt++;
+}
+
+uint8_t slack_repayTarget(const SlackStealer* s) {
+    uint8_t target = 0;
+    uint8_t i;
+    for (i = 1; i < s->count; i++) {
+        if (s->debt[i] && (!target || s->deadline[i] < s->deadline[target])) target = i;
+    }
+    return target;
+}
+
+void slack_settle(SlackStealer* s, PeriodicTaskSet ts, uint8_t index, bool repaid) {
+    if (!s->debt[index]) return;
+
+    if (repaid) {
+        s->debt[index]--;
+        s->totalDebt--;
+    }
+
+    //a job that finished early needed fewer slots than the table gave it, so nothing more is owed
+    if (ts.tasks[index].task->remainingCompTime == 0) {
+        s->totalDebt -= s->debt[index];
+        s->debt[index] = 0;
+    }
+}
+
+runFlag_t slack_release(SlackStealer* s, PeriodicTaskSet ts, uint8_t index) {
+    if (!s->debt[index]) return 0x0000;
+
+    if (ts.tasks[index].task->remainingCompTime > 0) return FLAG_DEADLINE_MISS | (index << 8);
+
+    s->totalDebt -= s->debt[index];
+    s->debt[index] = 0;
+    return 0x0000;
+}
@@ -0,0 +1,47 @@
+/*
+ * SlackStealer.h
+ *
+ *  slack stealing on top of a precomputed EDF table. a queued aperiodic job may take a slot the
+ *  table gave to a periodic task, which then owes that slot. debts are paid back in the table's
+ *  free slots (task 0 slots and idle slots) and in slots freed by early completion, earliest deadline
+ *  first. a slot is only stolen if every debt, including the new one, still fits in the free slots
+ *  left before the earliest deadline of an indebted job, so the table's guarantee is kept
+ */
+#ifndef SLACKSTEALER_H_
+#define SLACKSTEALER_H_
+
+#include "Scheduler.h"
+
+typedef struct {
+    uint32_t debt[SCHED_MAX_PERIODIC]; //slots each task's current job is owed
+    uint32_t deadline[SCHED_MAX_PERIODIC]; //absolute deadline of each indebted job
+    uint32_t totalDebt;
+    uint8_t count;
+} SlackStealer;
+
+//clears all debt. returns false if the task set has more tasks than the stealer can track
+bool slack_init(SlackStealer* s, PeriodicTaskSet ts);
+
+//number of free slots in the schedule after slot and before until
+//run is the index of the run containing slot and runStart the first slot of that run
+uint32_t slack_freeSlots(const PeriodicSchedule* schedule, uint32_t run, uint32_t runStart, uint32_t slot, uint32_t until);
+
+//returns true if aperiodic work may have the given slot without a periodic deadline miss
+//victim is the task the slot belongs to, or 0 if the slot is already free
+bool slack_canSteal(const SlackStealer* s, PeriodicTaskSet ts, const PeriodicSchedule* schedule,
+                    uint32_t run, uint32_t runStart, uint32_t slot, uint8_t victim);
+
+//records that victim's slot was given to aperiodic work
+void slack_steal(SlackStealer* s, PeriodicTaskSet ts, uint8_t victim, uint32_t slot);
+
+//returns the indebted task with the earliest deadline, or 0 if nothing is owed
+uint8_t slack_repayTarget(const SlackStealer* s);
+
+//settles debt after the task at index ran for a slot. repaid is true if that slot was a repayment
+void slack_settle(SlackStealer* s, PeriodicTaskSet ts, uint8_t index, bool repaid);
+
+//called before a new job of the task at index is released
+//returns FLAG_DEADLINE_MISS if the previous job was still owed slots
+runFlag_t slack_release(SlackStealer* s, PeriodicTaskSet ts, uint8_t index);
+
+#endif /* SLACKSTEALER_H_ */
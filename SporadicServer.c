@@ -0,0 +1,81 @@
+#include "SporadicServer.h"
+
+void ss_init(SporadicServer* s, uint32_t budget, uint32_t period) {
+    s->budget = budget;
+    s->period = period;
+    s->remaining = budget;
+    s->active = false;
+    s->activatedAt = 0;
+    s->consumed = 0;
+    s->pendingCount = 0;
+}
+
+//ends the current activation, the budget it used comes back one period after it started
+static void deactivate(SporadicServer* s) {
+    s->active = false;
+    if (!s->consumed) return;
+
+    uint32_t time = s->activatedAt + s->period;
+
+    if (s->pendingCount == SCHED_SERVER_REPLENISHMENTS) {
+        Replenishment* last = &(s->pending[s->pendingCount - 1]);
+        last->amount += s->consumed;
+        if (time > last->time) last->time = time;
+    }
+    else {
+        s->pending[s->pendingCount].time = time;
+        s->pending[s->pendingCount].amount = s->consumed;
+        s->pendingCount++;
+    }
+
+    s->consumed = 0;
+}
+
+bool ss_update(SporadicServer* s, uint32_t slot, bool work) {
+    //activations only move forward in time, so replenishments are due in order
+    uint8_t due = 0;
+    while (due < s->pendingCount && s->pending[due].time <= slot) {
+        s->remaining += s->pending[due].amount;
+        due++;
+    }
+    if (due) {
+        uint8_t i;
+        for (i = due; i < s->pendingCount; i++) s->pending[i - due] = s->pending[i];
+        s->pendingCount -= due;
+        if (s->remaining > s->budget) s->remaining = s->budget;
+    }
+
+    if (s->active && (!work || !s->remaining)) deactivate(s);
+
+    if (!s->active && work && s->remaining) {
+        s->active = true;
+        s->activatedAt = slot;
+        s->consumed = 0;
+    }
+
+    return s->active;
+}
+
+void ss_consume(SporadicServer* s) {
+    if (!s->remaining) return;
+    s->remaining--;
+    s->consumed++;
+    if (!s->remaining) deactivate(s);
+}
+
+uint32_t ss_deadline(const SporadicServer* s) {
+    return s->activatedAt + s->period;
+}
+
+void ss_rebase(SporadicServer* s, uint32_t slots) {
+    if (s->active) deactivate(s);
+
+    //anything due before the rebase point has already been applied
+    uint8_t i;
+    for (i = 0; i < s->pendingCount; i++) s->pending[i].time -= slots;
+}
+
+uint32_t ss_responseBound(const SporadicServer* s, uint32_t backlog) {
+    if (!s->budget) return UINT32_MAX;
+    return (backlog + s->budget - 1) / s->budget * s->period;
+}
@@ -0,0 +1,62 @@
+/*
+ * SporadicServer.h
+ *
+ *  bandwidth-reserving server for aperiodic work. the server holds a budget of Q slots that is
+ *  used up while it serves jobs and given back Q slots of time after the server became active,
+ *  so in any window of T slots it never uses more than Q. to the schedulability tests it looks
+ *  exactly like periodic task 0 with compTime Q and period T, which is how it is configured.
+ *  under EDF each activation gets the deadline activation + T (deadline sporadic server),
+ *  under fixed priorities it runs at the priority of task 0
+ */
+#ifndef SPORADICSERVER_H_
+#define SPORADICSERVER_H_
+
+#include "Scheduler.h"
+
+//pending replenishments the server can track. when full, new ones are merged into the latest one,
+//which only delays budget and so never breaks the guarantee
+#ifndef SCHED_SERVER_REPLENISHMENTS
+#define SCHED_SERVER_REPLENISHMENTS 4
+#endif
+
+typedef struct {
+    uint32_t time; //slot at which the budget comes back
+    uint32_t amount; //slots of budget that come back
+} Replenishment;
+
+typedef struct {
+    uint32_t budget; //Q, slots of service per period
+    uint32_t period; //T, slots
+    uint32_t remaining; //budget left right now
+    bool active; //serving, or waiting to serve, since activatedAt
+    uint32_t activatedAt; //slot the current activation started
+    uint32_t consumed; //budget used since activatedAt
+    Replenishment pending[SCHED_SERVER_REPLENISHMENTS]; //in time order
+    uint8_t pendingCount;
+} SporadicServer;
+
+//starts the server with a full budget
+void ss_init(SporadicServer* s, uint32_t budget, uint32_t period);
+
+//brings the server up to date at the start of a slot: applies due replenishments, then activates the server
+//if it has budget and work, or deactivates it if it has run out of either
+//returns true if the server is eligible to run this slot
+bool ss_update(SporadicServer* s, uint32_t slot, bool work);
+
+//charges one slot of service to the budget
+void ss_consume(SporadicServer* s);
+
+//absolute deadline of the current activation, only meaningful while active
+uint32_t ss_deadline(const SporadicServer* s);
+
+//subtracts the given number of slots from every stored time
+//an activation still open at that point is closed and will reopen on the next ss_update(),
+//splitting it in two is allowed by the replenishment rules and keeps every stored time in range
+void ss_rebase(SporadicServer* s, uint32_t slots);
+
+//worst-case response time, in slots, for aperiodic work posted to an idle server with a full budget,
+//given the total compTime queued ahead of it including itself
+//every Q slots of backlog finish within T slots of the activation that serves them
+uint32_t ss_responseBound(const SporadicServer* s, uint32_t backlog);
+
+#endif /* SPORADICSERVER_H_ */
@@ -6,12 +6,13 @@
  *      Adapted from (and compatible with) Eric Middleton's timer utility
  */
 
-// TODO: Check value of MICROS_PER_TICK
-
 #include "Timer.h"
 
-// 65000 gives a countdown time of exactly 65ms TODO: is it 65000 or 64999?
-#define MICROS_PER_TICK 64999UL // Number of microseconds in one timer cycle
+#ifndef SCHED_HOST
+
+#define CYCLES_PER_MICRO 16UL // WTIMER5 and TIMER4 run from the 16MHz system clock without a prescaler
+#define CYCLES_PER_MICRO_SHIFT 4 // log2(CYCLES_PER_MICRO)
+#define CYCLES_PER_MILLI 16000UL
 
 /**
  * @brief Tracks if the clock is currently running or stopped
@@ -20,46 +21,60 @@
 unsigned char _running = 0;
 
 /**
- * @brief Tracks the number of milliseconds passed since a call to startClock()
+ * @brief Function called from the TIMER4 ISR, NULL if there is none
+ *
+ */
+static void (*_fire_function)(void);
+
+/**
+ * @brief Interrupts left before TIMER4 is stopped, -1 to fire forever
  *
  */
-volatile unsigned int _timeout_ticks;
+static volatile int _fire_remaining;
+
+/**
+ * @brief Number of TIMER4 interrupts taken since power up
+ *
+ */
+static volatile unsigned int _fire_count;
+
+static void timer_fireHandler(void);
 
 /**
- * @brief Initialize and start the clock at 0. If the clock is
- * already running on a call, reset the time count back to 0. Uses TIMER5.
+ * @brief Initialize and start the clock at 0. A clock that was paused
+ * resumes where it left off. Uses WTIMER5 as a free-running 64-bit up counter
+ * of system clock cycles, so no interrupt is needed to extend it.
  *
  */
 void timer_init(void) {
     if (!_running) {
-        SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R5; // Turn on clock to TIMER5
-        TIMER5_CTL_R &= ~TIMER_CTL_TAEN;           // Disable TIMER5 for setup
-        TIMER5_CFG_R = TIMER_CFG_16_BIT;           // Set as 16-bit timer
-        TIMER5_TAMR_R = TIMER_TAMR_TAMR_PERIOD;    // Periodic, countdown mode
-        TIMER5_TAILR_R = MICROS_PER_TICK - 1;      // Countdown time of 65ms
-        TIMER5_ICR_R |= TIMER_ICR_TATOCINT; // Clear timeout interrupt status
-        TIMER5_TAPR_R = 0x0F;               // 15 gives a period of 1us
-        TIMER5_IMR_R |= TIMER_IMR_TATOIM;   // Allow TIMER5 timeout interrupts
-        NVIC_PRI23_R |= NVIC_PRI23_INTA_M;  // Priority 7 (lowest)
-        NVIC_EN2_R |= (1 << 28);             // Enable TIMER5 interrupts
-
-        IntRegister(INT_TIMER5A, timer_clockTickHandler); // Bind the ISR
-        TIMER5_CTL_R |= TIMER_CTL_TAEN; // Start TIMER5 counting
+        if (!(SYSCTL_RCGCWTIMER_R & SYSCTL_RCGCWTIMER_R5)) {
+            SYSCTL_RCGCWTIMER_R |= SYSCTL_RCGCWTIMER_R5; // Turn on clock to WTIMER5
+            while (!(SYSCTL_PRWTIMER_R & SYSCTL_PRWTIMER_R5)) { }
 
+            WTIMER5_CTL_R &= ~TIMER_CTL_TAEN;          // Disable WTIMER5 for setup
+            WTIMER5_CFG_R = TIMER_CFG_32_BIT_TIMER;    // Concatenate A and B, 64 bits on a wide timer
+            WTIMER5_TAMR_R = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR; // Periodic, count up
+            WTIMER5_TAILR_R = 0xFFFFFFFF;              // Count all the way up, lower half
+            WTIMER5_TBILR_R = 0xFFFFFFFF;              // Upper half
+            WTIMER5_IMR_R = 0;                         // No interrupts, reads never need one
+            WTIMER5_TAV_R = 0;                         // Start at 0
+            WTIMER5_TBV_R = 0;
+        }
+
+        WTIMER5_CTL_R |= TIMER_CTL_TAEN; // Start WTIMER5 counting
         _running = 1;
     }
 }
 
 /**
- * @brief Stop the clock and free up TIMER5. Resets the value returned by
+ * @brief Stop the clock and free up WTIMER5. Resets the value returned by
  * timer_getMillis() and timer_getMicros().
  *
  */
 void timer_stop(void) {
-    TIMER5_CTL_R &= ~TIMER_CTL_TAEN;            // Disable TIMER5
-    _timeout_ticks = 0;                         // Reset tick counter
-    TIMER5_TAV_R = MICROS_PER_TICK;             // Set TIMER5 back to the top
-    SYSCTL_RCGCTIMER_R &= ~SYSCTL_RCGCTIMER_R5; // Turn off clock to TIMER5
+    WTIMER5_CTL_R &= ~TIMER_CTL_TAEN;             // Disable WTIMER5
+    SYSCTL_RCGCWTIMER_R &= ~SYSCTL_RCGCWTIMER_R5; // Turn off clock to WTIMER5, the next init starts over at 0
     _running = 0;
 }
 
@@ -68,7 +83,7 @@ void timer_stop(void) {
  *
  */
 void timer_pause(void) {
-    TIMER5_CTL_R &= ~TIMER_CTL_TAEN; // Disable TIMER5
+    WTIMER5_CTL_R &= ~TIMER_CTL_TAEN; // Disable WTIMER5
     _running = 0;
 }
 
@@ -77,10 +92,31 @@ void timer_pause(void) {
  *
  */
 void timer_resume(void) {
-    TIMER5_CTL_R |= TIMER_CTL_TAEN; // Enable TIMER5
+    WTIMER5_CTL_R |= TIMER_CTL_TAEN; // Enable WTIMER5
     _running = 1;
 }
 
+/**
+ * @brief Returns the 64-bit cycle count of WTIMER5. The upper half is read on
+ * both sides of the lower one, so a carry between the reads is seen and the
+ * lower half read again. Needs no interrupt masking, an ISR can call it too.
+ *
+ * @return uint64_t system clock cycles since timer_init()
+ */
+static uint64_t timer_getCycles64(void) {
+    uint32_t high = WTIMER5_TBV_R;
+    uint32_t low = WTIMER5_TAV_R;
+    uint32_t check = WTIMER5_TBV_R;
+
+    if (check != high) {
+        // The lower half wrapped between the reads, it is small again now
+        high = check;
+        low = WTIMER5_TAV_R;
+    }
+
+    return ((uint64_t)high << 32) | low;
+}
+
 /**
  * @brief Returns the number milliseconds that have passed since startClock()
  * was called. Value rolls over after about 49 days.
@@ -89,23 +125,7 @@ void timer_resume(void) {
  * timer_startClock()
  */
 unsigned int timer_getMillis(void) {
-    unsigned int ticks;
-    unsigned int millis;
-
-    TIMER5_IMR_R &= ~TIMER_IMR_TATOIM; // Disable timeout interrupts
-
-    millis = (MICROS_PER_TICK - TIMER5_TAR_R & 0xFFFF) / 1000;
-    if (TIMER5_RIS_R & TIMER_RIS_TATORIS) {
-        // If the timer overflows while we're getting the time
-        ticks = (_timeout_ticks + 1);
-        millis = 0;
-    } else {
-        ticks = _timeout_ticks;
-    }
-
-    TIMER5_IMR_R |= TIMER_IMR_TATOIM; // Reenable interrupts from TIMER timeout
-
-    return ticks * (MICROS_PER_TICK / 1000) + millis;
+    return (unsigned int)(timer_getMicros64() / 1000);
 }
 
 /**
@@ -115,26 +135,20 @@ unsigned int timer_getMillis(void) {
  * @return unsigned int number of microseconds since a call to startClock()
  */
 unsigned int timer_getMicros(void) {
-    unsigned int ticks;
-    unsigned int micros;
-    if(!_running){
-           timer_init();
-    }
-    TIMER5_IMR_R &= ~TIMER_IMR_TATOIM; // Disable TIMER5 timeout interrupts
-
-    micros = MICROS_PER_TICK - TIMER5_TAR_R & 0xFFFF;
+    return (unsigned int)timer_getMicros64();
+}
 
-    if (TIMER5_RIS_R & TIMER_RIS_TATORIS) {
-        // If the timer overflows while we're getting the time
-        ticks = (_timeout_ticks + 1);
-        micros = 0;
-    } else {
-        ticks = _timeout_ticks;
+/**
+ * @brief Returns the number of microseconds passed since a call to
+ * startClock() as a 64-bit value that does not roll over.
+ *
+ * @return uint64_t number of microseconds since a call to startClock()
+ */
+uint64_t timer_getMicros64(void) {
+    if (!_running) {
+        timer_init();
     }
-
-    TIMER5_IMR_R |= TIMER_IMR_TATOIM; // Reenable TIMER5 interrupts
-
-    return ticks * MICROS_PER_TICK + micros;
+    return timer_getCycles64() >> CYCLES_PER_MICRO_SHIFT;
 }
 
 /**
@@ -193,11 +207,122 @@ void timer_waitMillis(uint32_t delay_time) {
 }
 
 /**
- * @brief ISR handler to increment the timeout variable for tracking total
- * milliseconds
+ * @brief Sets up TIMER4 as a 32-bit countdown that interrupts every cycles
+ * system clock cycles, times times or forever if times is -1.
+ *
+ */
+static void timer_fireSetup(void (*f)(void), uint32_t cycles, int times) {
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4; // Turn on clock to TIMER4
+    TIMER4_CTL_R &= ~TIMER_CTL_TAEN;           // Disable TIMER4 for setup
+
+    _fire_function = f;
+    _fire_remaining = times;
+
+    TIMER4_CFG_R = TIMER_CFG_32_BIT_TIMER; // Concatenate A and B for 32 bits
+    TIMER4_TAMR_R = (times == 1) ? TIMER_TAMR_TAMR_1_SHOT : TIMER_TAMR_TAMR_PERIOD; // Countdown
+    TIMER4_TAILR_R = cycles - 1;         // Countdown time
+    TIMER4_ICR_R |= TIMER_ICR_TATOCINT;  // Clear timeout interrupt status
+    TIMER4_IMR_R |= TIMER_IMR_TATOIM;    // Allow TIMER4 timeout interrupts
+    NVIC_PRI17_R = (NVIC_PRI17_R & ~NVIC_PRI17_INTC_M) | (6 << NVIC_PRI17_INTC_S); // Priority 6
+    NVIC_EN2_R |= (1 << 6);              // Enable TIMER4A interrupts
+
+    IntRegister(INT_TIMER4A, timer_fireHandler); // Bind the ISR
+    TIMER4_CTL_R |= TIMER_CTL_TAEN; // Start TIMER4 counting
+}
+
+/**
+ * @brief Sets up an interrupt to call the given function once every given
+ * milliseconds. Uses TIMER4 for the countdown.
+ *
+ * @param f the function to call
+ * @param millis the interval between calls
+ */
+void timer_fireEvery(void (*f)(void), int millis) {
+    timer_fireSetup(f, millis * CYCLES_PER_MILLI, -1);
+}
+
+/**
+ * @brief Sets up an interrupt to call the given function once every given
+ * microseconds. Uses TIMER4 for the countdown.
+ *
+ * @param f the function to call
+ * @param micros the interval between calls
+ */
+void timer_fireEveryMicros(void (*f)(void), unsigned int micros) {
+    timer_fireSetup(f, micros * CYCLES_PER_MICRO, -1);
+}
+
+/**
+ * @brief Sets up an interrupt to call the given function after the given number
+ * of milliseconds. Uses TIMER4 for the countdown.
+ *
+ * @param f the function to call
+ * @param millis milliseconds until call
+ */
+void timer_fireOnce(void (*f)(void), int millis) {
+    timer_fireSetup(f, millis * CYCLES_PER_MILLI, 1);
+}
+
+/**
+ * @brief Sets up an interrupt to call the given function after the given number
+ * of milliseconds for the given number of times. Uses TIMER4 for the countdown.
+ *
+ * @param f the function to call
+ * @param millis milliseconds until call
+ * @param times number of times to call f
+ */
+void timer_fireFor(void (*f)(void), int millis, int times) {
+    if (times > 0) timer_fireSetup(f, millis * CYCLES_PER_MILLI, times);
+}
+
+/**
+ * @brief Cancels any interrupt set up by the fire functions and frees up TIMER4.
+ *
+ */
+void timer_fireStop(void) {
+    TIMER4_CTL_R &= ~TIMER_CTL_TAEN;            // Disable TIMER4
+    TIMER4_IMR_R &= ~TIMER_IMR_TATOIM;          // Mask TIMER4 timeout interrupts
+    NVIC_DIS2_R = (1 << 6);                     // Disable TIMER4A interrupts
+    SYSCTL_RCGCTIMER_R &= ~SYSCTL_RCGCTIMER_R4; // Turn off clock to TIMER4
+    _fire_remaining = 0;
+}
+
+/**
+ * @brief Returns the number of TIMER4 interrupts taken so far.
+ *
+ * @return unsigned int number of TIMER4 interrupts since power up
+ */
+unsigned int timer_fireCount(void) {
+    return _fire_count;
+}
+
+/**
+ * @brief Sleeps the core until the next interrupt if idle() returns true.
+ *
+ * @param idle returns true if there is still nothing to do
+ */
+void timer_idle(bool (*idle)(void)) {
+    IntMasterDisable(); // A pending interrupt still wakes WFI while masked
+    if (idle()) {
+        __asm(" wfi");
+    }
+    IntMasterEnable(); // Take the interrupt that woke us
+}
+
+/**
+ * @brief ISR handler for TIMER4, counts the interrupt, stops TIMER4 after the
+ * last one and calls the function set up by the fire functions
  *
  */
-static void timer_clockTickHandler() {
-    TIMER5_ICR_R |= TIMER_ICR_TATOCINT; // Clear interrupt flag
-    _timeout_ticks++;
+static void timer_fireHandler(void) {
+    TIMER4_ICR_R |= TIMER_ICR_TATOCINT; // Clear interrupt flag
+    _fire_count++;
+
+    if (_fire_remaining > 0 && --_fire_remaining == 0) {
+        TIMER4_CTL_R &= ~TIMER_CTL_TAEN; // Last call, stop counting
+    }
+
+    if (_fire_function) _fire_function();
 }
+
+#endif /* SCHED_HOST */
@@ -8,20 +8,25 @@
 #ifndef TIMER_H_
 #define TIMER_H_
 
-#include <inc/tm4c123gh6pm.h>
 #include <stdbool.h>
 #include <stdint.h>
+
+// Define SCHED_HOST to build against the Linux backend in host/TimerHost.c
+// instead of the TM4C WTIMER5 and TIMER4 implementation in Timer.c
+#ifndef SCHED_HOST
+#include <inc/tm4c123gh6pm.h>
 #include "driverlib/interrupt.h"
+#endif
 
 /**
- * @brief Initialize and start the clock at 0. If the clock is
- * already running on a call, reset the time count back to 0. Uses TIMER5.
+ * @brief Initialize and start the clock at 0. A clock that was paused
+ * resumes where it left off. Uses WTIMER5.
  *
  */
 void timer_init(void);
 
 /**
- * @brief Stop the clock and free up TIMER5. Resets the value returned by
+ * @brief Stop the clock and free up WTIMER5. Resets the value returned by
  * getMillis() and get Micros().
  *
  */
@@ -56,6 +61,17 @@ unsigned int timer_getMillis(void);
  */
 unsigned int timer_getMicros(void);
 
+/**
+ * @brief Returns the number of microseconds passed since a call to
+ * startClock() as a 64-bit value, which will not roll over. Lock-free and
+ * never masks an interrupt: it reads the 64-bit WTIMER5 count directly, so it
+ * costs a few cycles and is safe to call from an ISR. timer_getMicros() and
+ * timer_getMillis() are the same count cut down to 32 bits.
+ *
+ * @return uint64_t number of microseconds since a call to startClock()
+ */
+uint64_t timer_getMicros64(void);
+
 /**
  * @brief Pauses execution for the specifeid number of microseconds.
  *
@@ -70,19 +86,27 @@ void timer_waitMillis(unsigned int delay_time);
  */
 void timer_waitMicros(unsigned int delay_time);
 
-// TODO: Implement
 /**
  * @brief Sets up an interrupt to call the given function once every given
  * milliseconds. Uses TIMER4 for the countdown. Function f executes inside an
- * ISR, so keep the passed function as short as possible. Maximum interval time
- * is TODO: calculate
+ * ISR, so keep the passed function as short as possible. f may be NULL if only
+ * timer_fireCount() is needed. Maximum interval time is 268435ms, 2^32 cycles
+ * of the 16MHz system clock.
  *
  * @param f the function to call
  * @param millis the interval between calls
  */
 void timer_fireEvery(void (*f)(void), int millis);
 
-// TODO: Implement
+/**
+ * @brief Same as timer_fireEvery() with the interval in microseconds. Maximum
+ * interval time is 268435455us.
+ *
+ * @param f the function to call
+ * @param micros the interval between calls
+ */
+void timer_fireEveryMicros(void (*f)(void), unsigned int micros);
+
 /**
  * @brief Sets up an interrupt to call the given function after the given number
  * of milliseconds. Uses TIMER4 for the countdown, and thus can only be used
@@ -94,13 +118,12 @@ void timer_fireEvery(void (*f)(void), int millis);
  */
 void timer_fireOnce(void (*f)(void), int millis);
 
-// TODO: Implement
 /**
  * @brief Sets up an interrupt to call the given function after the given number
  * of milliseconds for the given number of times. Uses TIMER4 for the countdown,
  * and thus can only be used when fireOnce() and fireEvery() are not being used.
  * Function f executes inside an ISR and should be kept as short as possible.
- * Maximum interval time is TODO: calculate
+ * Maximum interval time is 268435ms, 2^32 cycles of the 16MHz system clock.
  *
  * @param f the function to call
  * @param millis milliseconds until call
@@ -109,10 +132,69 @@ void timer_fireOnce(void (*f)(void), int millis);
 void timer_fireFor(void (*f)(void), int millis, int times);
 
 /**
- * @brief ISR handler to increment the timeout variable for tracking total
- * milliseconds
+ * @brief Cancels any interrupt set up by timer_fireEvery(), timer_fireOnce()
+ * or timer_fireFor() and frees up TIMER4.
+ *
+ */
+void timer_fireStop(void);
+
+/**
+ * @brief Returns the number of TIMER4 interrupts taken so far. Only ever
+ * counts up, so the number of interrupts between two calls is the difference
+ * of the values returned. Reads a single variable updated by the ISR, so it is
+ * much cheaper than timer_getMicros().
+ *
+ * @return unsigned int number of TIMER4 interrupts since power up
+ */
+unsigned int timer_fireCount(void);
+
+/**
+ * @brief Sleeps the core with WFI until the next interrupt if idle() returns
+ * true. idle() is called with interrupts masked, so an interrupt that arrives
+ * after it has looked can't be missed: it wakes the core straight away and
+ * runs once this function returns. On the host the virtual clock skips ahead
+ * to the next TIMER4 interrupt instead.
+ *
+ * @param idle returns true if there is still nothing to do
+ */
+void timer_idle(bool (*idle)(void));
+
+#ifdef SCHED_HOST
+/**
+ * @brief Selects the clock backing the host timer. The virtual clock is
+ * deterministic: it only moves when a task waits, when the clock is read (see
+ * timer_host_setReadCost()) or when it is advanced explicitly. The wall clock
+ * follows CLOCK_MONOTONIC. Defaults to the virtual clock.
+ *
+ * @param virtualClock true for virtual time, false for wall-clock time
+ */
+void timer_host_useVirtualClock(bool virtualClock);
+
+/**
+ * @brief Sets how many virtual microseconds each call to timer_getMicros() or
+ * timer_getMillis() costs. Models the time a task spends between yields so
+ * that run() makes progress even if a task never waits. Defaults to 1.
+ *
+ * @param micros virtual microseconds charged per clock read
+ */
+void timer_host_setReadCost(unsigned int micros);
+
+/**
+ * @brief Advances the virtual clock by the given number of microseconds.
+ * Has no effect in wall-clock mode or while the clock is paused.
+ *
+ * @param micros number of microseconds to advance by
+ */
+void timer_host_advanceMicros(unsigned int micros);
+
+/**
+ * @brief Runs f once the emulated TIMER4 interrupt being serviced returns, as
+ * PendSV would on the target. Meant to be called from a timer_fire function.
+ * Only one function can be pending, a later call replaces an earlier one.
  *
+ * @param f the function to run
  */
-static void timer_clockTickHandler();
+void timer_host_pend(void (*f)(void));
+#endif
 
 #endif /* TIMER_H_ */
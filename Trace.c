@@ -0,0 +1,181 @@
+#include "Trace.h"
+#include "Atomic.h"
+#include "Timer.h"
+
+#ifndef SCHED_HOST
+//kept out of the SCHED_TRACE build switch, the benchmarks report over the same port
+void trace_uartInit(void) {
+    SYSCTL_RCGCUART_R |= SYSCTL_RCGCUART_R0; // Turn on clock to UART0
+    SYSCTL_RCGCGPIO_R |= SYSCTL_RCGCGPIO_R0; // Turn on clock to GPIOA
+    while (!(SYSCTL_PRGPIO_R & SYSCTL_PRGPIO_R0)) { }
+
+    GPIO_PORTA_AFSEL_R |= 0x03;              // PA0 and PA1 to their alternate function
+    GPIO_PORTA_PCTL_R = (GPIO_PORTA_PCTL_R & ~0xFF) | GPIO_PCTL_PA0_U0RX | GPIO_PCTL_PA1_U0TX;
+    GPIO_PORTA_DEN_R |= 0x03;
+
+    UART0_CTL_R &= ~UART_CTL_UARTEN;         // Disable UART0 for setup
+    UART0_IBRD_R = 8;                        // 16MHz / (16 * 115200) = 8.68
+    UART0_FBRD_R = 44;                       // 0.68 * 64 + 0.5
+    UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN; // 8N1 with FIFOs
+    UART0_CC_R = UART_CC_CS_SYSCLK;          // Clocked from the system clock
+    UART0_CTL_R |= UART_CTL_UARTEN | UART_CTL_TXE | UART_CTL_RXE;
+}
+#endif
+
+#if SCHED_TRACE
+
+#ifdef SCHED_HOST
+#include <stdio.h>
+#endif
+
+#define TRACE_MASK (SCHED_TRACE_EVENTS - 1)
+#define RECORD_MAX 7 //type, arg and a varint of up to 5 bytes
+
+//one recorded event. published through sequence the same way as the aperiodic queue
+typedef struct {
+    volatile uint32_t sequence;
+    uint32_t time;
+    uint8_t type;
+    uint8_t arg;
+} TraceSlot;
+
+static TraceSlot ring[SCHED_TRACE_EVENTS];
+static volatile uint32_t head; //next position a producer claims
+static uint32_t tail; //next position the drain reads
+static volatile uint32_t lost; //events dropped since the last TRACE_LOST record
+
+//encoder state, only touched by trace_drain()
+static uint8_t record[RECORD_MAX]; //the record being sent
+static uint8_t recordLength;
+static uint8_t recordSent;
+static uint32_t lastTime; //time of the previous record, deltas are taken from it
+static bool synced; //TRACE_SYNC has been sent
+
+#ifndef SCHED_HOST
+//writes one byte to the UART0 FIFO. returns false instead of waiting if the FIFO is full
+static bool sinkPut(uint8_t byte) {
+    if (UART0_FR_R & UART_FR_TXFF) return false;
+    UART0_DR_R = byte;
+    return true;
+}
+#else
+static FILE* sink = NULL;
+
+//the host sink never blocks. without a file the stream is thrown away
+static bool sinkPut(uint8_t byte) {
+    if (sink) fputc(byte, sink);
+    return true;
+}
+
+bool trace_host_open(const char* path) {
+    if (sink) fclose(sink);
+    sink = fopen(path, "wb");
+    return sink != NULL;
+}
+
+void trace_host_close(void) {
+    trace_drain();
+    if (sink) fclose(sink);
+    sink = NULL;
+}
+#endif
+
+void trace_init(void) {
+    uint32_t i;
+    for (i = 0; i < SCHED_TRACE_EVENTS; i++) ring[i].sequence = i;
+    head = 0;
+    tail = 0;
+    lost = 0;
+    recordLength = 0;
+    recordSent = 0;
+    lastTime = 0;
+    synced = false;
+}
+
+void trace_event(TraceEventType type, uint32_t arg) {
+    uint32_t pos = head;
+    uint32_t time;
+    TraceSlot* slot;
+
+    while (1) {
+        slot = &(ring[pos & TRACE_MASK]);
+        int32_t diff = (int32_t)(slot->sequence - pos);
+
+        if (diff == 0) {
+            //stamp right before claiming. an event that interrupts us in between claims pos first, so our claim fails
+            //and we stamp again, which keeps the times in ring order and the drain's deltas from going negative
+            time = timer_getMicros();
+            if (atomic_compareAndSwap(&head, pos, pos + 1)) break;
+            pos = head;
+        }
+        else if (diff < 0) {
+            atomic_increment(&lost); //full, the drain has fallen behind
+            return;
+        }
+        else {
+            pos = head;
+        }
+    }
+
+    slot->time = time;
+    slot->type = type;
+    slot->arg = arg > 0xFF ? 0xFF : arg;
+
+    ATOMIC_BARRIER();
+    slot->sequence = pos + 1;
+}
+
+//puts a record in the send buffer
+static void encode(uint8_t type, uint8_t arg, uint32_t value) {
+    record[0] = type;
+    record[1] = arg;
+    recordLength = 2;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        record[recordLength++] = value ? byte | 0x80 : byte;
+    } while (value);
+    recordSent = 0;
+}
+
+void trace_drain(void) {
+    while (1) {
+        //finish the record in flight first
+        while (recordSent < recordLength) {
+            if (!sinkPut(record[recordSent])) return;
+            recordSent++;
+        }
+
+        TraceSlot* slot = &(ring[tail & TRACE_MASK]);
+        bool ready = slot->sequence == tail + 1;
+
+        if (!synced) {
+            //the stream starts at the first event, or now if there is none yet
+            uint32_t now = ready ? slot->time : timer_getMicros();
+            encode(TRACE_SYNC, TRACE_VERSION, now);
+            lastTime = now;
+            synced = true;
+        }
+        else if (lost) {
+            uint32_t count = lost;
+            while (!atomic_compareAndSwap(&lost, count, 0)) count = lost;
+            encode(TRACE_LOST, count > 0xFF ? 0xFF : count, 0);
+        }
+        else if (ready) {
+            ATOMIC_BARRIER();
+            //an event stamped before the last one sent goes out with a delta of 0 instead of wrapping to ~2^32 us
+            int32_t delta = (int32_t)(slot->time - lastTime);
+            if (delta > 0) lastTime = slot->time;
+            encode(slot->type, slot->arg, delta > 0 ? (uint32_t)delta : 0);
+
+            ATOMIC_BARRIER();
+            slot->sequence = tail + SCHED_TRACE_EVENTS;
+            tail++;
+        }
+        else {
+            return;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Trace.h
+ *
+ *  binary scheduling trace. events go into a lock-free ring in RAM, so they can be recorded from any
+ *  context including ISRs, and are drained in idle time to UART0 (a file or pty on the host)
+ *
+ *  stream format, one record per event:
+ *      byte 0      event type, see TraceEventType
+ *      byte 1      argument, usually a task index
+ *      bytes 2..   microseconds since the previous record as an unsigned LEB128 varint
+ *                  never negative: an event stamped before the previous record is sent with 0 and takes that record's
+ *                  time. a gap of 2^31 us or more between two records reads as negative, so it is sent as 0 as well
+ *  the first record of a stream is TRACE_SYNC, whose varint is the absolute timer_getMicros() time instead
+ *  host/traceDecode.c turns a stream into Chrome trace_event JSON and a text Gantt chart
+ */
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "Scheduler.h"
+
+//set SCHED_TRACE to 0 to compile tracing out
+#ifndef SCHED_TRACE
+#define SCHED_TRACE 1
+#endif
+#ifndef SCHED_TRACE_EVENTS
+#define SCHED_TRACE_EVENTS 128 //events the ring holds before new ones are dropped, must be a power of two
+#endif
+
+#if (SCHED_TRACE_EVENTS & (SCHED_TRACE_EVENTS - 1)) != 0
+#error "SCHED_TRACE_EVENTS must be a power of two"
+#endif
+
+typedef enum {
+    TRACE_SYNC = 0,   //start of a stream, arg is the format version
+    TRACE_SLOT,       //a slot started, arg is the task dispatched in it
+    TRACE_YIELD,      //a task function returned, arg is the task
+    TRACE_FINISH,     //a job finished, arg is the task
+    TRACE_OVERRUN,    //a task did not yield in time or ran out of compTime, arg is the task
+    TRACE_MISS,       //a job missed its deadline, arg is the task
+    TRACE_APER_POST,  //an aperiodic job was queued, arg is the number of jobs queued before it
+    TRACE_APER_START, //the aperiodic server started a job
+    TRACE_APER_DONE,  //the aperiodic server finished a job
+    TRACE_IDLE,       //the core went to sleep until the next interrupt
+    TRACE_LOST        //events were dropped because the ring was full, arg is how many
+} TraceEventType;
+
+#define TRACE_VERSION 1
+
+#if SCHED_TRACE
+
+//empties the ring and starts a new stream with TRACE_SYNC. not safe while events are being recorded
+void trace_init(void);
+
+//records an event stamped with timer_getMicros(). arg is capped at 255
+//safe to call from any context, including ISRs
+void trace_event(TraceEventType type, uint32_t arg);
+
+//encodes recorded events into the sink for as long as it can take bytes without blocking
+//call it from one context only, run() does so whenever the core is about to go idle
+void trace_drain(void);
+
+#ifdef SCHED_HOST
+//sends the stream to the given file, which may be a pty. returns false if it could not be opened
+bool trace_host_open(const char* path);
+
+//writes out everything still in the ring and closes the file
+void trace_host_close(void);
+#endif
+
+#else
+
+#define trace_init() ((void)0)
+#define trace_event(type, arg) ((void)0)
+#define trace_drain() ((void)0)
+
+#endif
+
+#ifndef SCHED_HOST
+//sets up UART0 at 115200 baud, 8N1 on PA0/PA1, as the trace sink. available even with SCHED_TRACE 0
+void trace_uartInit(void);
+#endif
+
+#endif /* TRACE_H_ */
@@ -1,17 +1,26 @@
-#include <stdint.h>
-#include "Scheduler.h"
+#include "Utils.h"
 
-uint32_t leastCommonMultiple(PeriodicTaskSet ts) {
-    uint32_t max = 0;
-    while(1) {
-        uint8_t flag = false;
-        uint8_t i;
-        for(i = 0; i < ts.size; i++) {
-            uint32_t p = ts.tasks[i].period;
-            if(p > max) max = p;
-            if(max % p) flag = true;
-        }
-        if (!flag) return max;
-        max++;
+uint32_t greatestCommonDivisor(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
     }
+    return a;
+}
+
+bool leastCommonMultiple(PeriodicTaskSet ts, uint32_t* lcm) {
+    uint32_t result = 1;
+    uint8_t i;
+    for (i = 0; i < ts.size; i++) {
+        uint32_t p = ts.tasks[i].period;
+        if (p == 0) return false;
+
+        //lcm(a, b) = a / gcd(a, b) * b, dividing first keeps the intermediate small
+        uint32_t reduced = result / greatestCommonDivisor(result, p);
+        if (reduced > UINT32_MAX / p) return false; //overflow
+        result = reduced * p;
+    }
+    *lcm = result;
+    return true;
 }
@@ -1,3 +1,15 @@
+#ifndef UTILS_H_
+#define UTILS_H_
+
+#include <stdint.h>
 #include <stdbool.h>
+#include "Scheduler.h"
+
+//greatest common divisor by Euclid's algorithm. gcd(a, 0) is a
+uint32_t greatestCommonDivisor(uint32_t a, uint32_t b);
+
+//computes the hyperperiod (least common multiple of every period) of a task set into lcm
+//returns false if a period is 0 or the result does not fit in 32 bits, lcm is left untouched in that case
+bool leastCommonMultiple(PeriodicTaskSet ts, uint32_t* lcm);
 
-uint32_t leastCommonMultiple(PeriodicTaskSet);
+#endif /* UTILS_H_ */
@@ -0,0 +1,94 @@
+/*
+ * ContextHost.c
+ *
+ *  Linux implementation of the Context.h API on top of ucontext. The slot
+ *  tick is an emulated interrupt (see TimerHost.c), so a context can only be
+ *  preempted while it reads, waits on or advances the clock. The switch back
+ *  to the scheduler is deferred with timer_host_pend() until the emulated
+ *  interrupt returns, as PendSV defers it on the target.
+ *
+ *  Only compiled when SCHED_HOST is defined so CCS can keep building the
+ *  project folder as-is.
+ */
+
+#ifdef SCHED_HOST
+
+#include "Context.h"
+#include "Timer.h"
+
+#define CTX_CANARY 0xC0FFEE11UL
+
+/**
+ * @brief The scheduler's context while a task context runs
+ *
+ */
+static ucontext_t _scheduler;
+
+/**
+ * @brief The context on the CPU, NULL while the scheduler runs
+ *
+ */
+static Context* _running = 0;
+
+//first and only frame of every context
+static void trampoline(void) {
+    Context* c = _running;
+    c->entry(c->arg);
+    c->finished = true;
+
+    //a finished context is never resumed, so this never returns
+    _running = 0;
+    swapcontext(&c->uc, &_scheduler);
+}
+
+//runs once the emulated interrupt that called ctx_preempt() is over
+static void switchOut(void) {
+    Context* c = _running;
+    if (!c) return;
+
+    _running = 0;
+    swapcontext(&c->uc, &_scheduler);
+}
+
+void ctx_init(void) {
+    _running = 0;
+}
+
+void ctx_start(Context* c, uint32_t* stack, uint32_t words, void (*entry)(void* arg), void* arg) {
+    uint32_t i;
+
+    c->stack = stack;
+    c->entry = entry;
+    c->arg = arg;
+    c->finished = false;
+    for (i = 0; i < SCHED_STACK_GUARD_WORDS; i++) stack[i] = CTX_CANARY;
+
+    getcontext(&c->uc);
+    c->uc.uc_stack.ss_sp = stack;
+    c->uc.uc_stack.ss_size = words * sizeof(uint32_t);
+    c->uc.uc_link = 0;
+    makecontext(&c->uc, trampoline, 0);
+}
+
+bool ctx_resume(Context* c) {
+    if (c->finished) return true;
+
+    _running = c;
+    swapcontext(&_scheduler, &c->uc);
+
+    return c->finished;
+}
+
+void ctx_preempt(void) {
+    if (_running) timer_host_pend(switchOut);
+}
+
+bool ctx_stackIntact(const Context* c) {
+    uint32_t i;
+    for (i = 0; i < SCHED_STACK_GUARD_WORDS; i++) {
+        if (c->stack[i] != CTX_CANARY) return false;
+    }
+    return true;
+}
+
+#endif /* SCHED_HOST */
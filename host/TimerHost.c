@@ -0,0 +1,265 @@
+/*
+ * TimerHost.c
+ *
+ *  Linux implementation of the Timer.h API so the scheduler can be built and
+ *  run off target. Defaults to a deterministic virtual clock; a wall-clock mode
+ *  backed by CLOCK_MONOTONIC is available through timer_host_useVirtualClock().
+ *  TIMER4 interrupts from the timer_fire functions are emulated: they are taken
+ *  whenever the clock is read, waited on or advanced past the time they are due,
+ *  and timer_fireCount() counts as a clock read. timer_host_pend() stands in for
+ *  PendSV, running a function once the emulated interrupt returns.
+ *
+ *  Only compiled when SCHED_HOST is defined so CCS can keep building the
+ *  project folder as-is.
+ */
+
+#ifdef SCHED_HOST
+
+#include "Timer.h"
+
+#include <time.h>
+
+/**
+ * @brief Tracks if the clock is currently running or stopped
+ *
+ */
+static bool _running = false;
+
+/**
+ * @brief Tracks if the clock has been started and not stopped since, paused
+ * or not. Like the WTIMER5 clock gate on the target, it decides whether
+ * timer_init() starts over at 0 or picks up where a pause left off.
+ *
+ */
+static bool _started = false;
+
+/**
+ * @brief true when time is virtual, false when it follows CLOCK_MONOTONIC
+ *
+ */
+static bool _virtual = true;
+
+/**
+ * @brief Virtual microseconds charged for every clock read
+ *
+ */
+static unsigned int _read_cost = 1;
+
+/**
+ * @brief Microseconds accumulated while the clock was running. In wall-clock
+ * mode this holds the time up to the last pause.
+ *
+ */
+static uint64_t _elapsed_micros = 0;
+
+/**
+ * @brief CLOCK_MONOTONIC value at the last resume in wall-clock mode
+ *
+ */
+static uint64_t _resumed_at = 0;
+
+/**
+ * @brief Emulated TIMER4 state. _fire_remaining is -1 while firing forever and
+ * 0 when nothing is set up.
+ *
+ */
+static void (*_fire_function)(void) = 0;
+static int _fire_remaining = 0;
+static uint64_t _fire_interval = 0;
+static uint64_t _fire_next = 0;
+static volatile unsigned int _fire_count = 0;
+static bool _in_fire = false;
+
+/**
+ * @brief Function pended by timer_host_pend(), 0 if there is none
+ *
+ */
+static void (*_pended)(void) = 0;
+
+static uint64_t monotonicMicros(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+//returns the current clock value without charging for the read
+static uint64_t currentMicros(void) {
+    if (_virtual || !_running) return _elapsed_micros;
+    return _elapsed_micros + (monotonicMicros() - _resumed_at);
+}
+
+//takes every emulated interrupt that is due. the handler may read the clock itself, so it is not reentered
+static void serviceFires(void) {
+    if (_in_fire) return;
+    _in_fire = true;
+
+    while (_fire_remaining != 0 && currentMicros() >= _fire_next) {
+        void (*f)(void) = _fire_function;
+
+        _fire_count++;
+        _fire_next += _fire_interval;
+        if (_fire_remaining > 0) _fire_remaining--;
+
+        if (f) f();
+    }
+
+    _in_fire = false;
+
+    //like PendSV, the pended function runs after the interrupt that pended it, in whatever it interrupted
+    if (_pended) {
+        void (*f)(void) = _pended;
+        _pended = 0;
+        f();
+    }
+}
+
+//charges the virtual read cost and returns the current clock value
+static uint64_t readMicros(void) {
+    if (!_running) timer_init();
+    if (_virtual) _elapsed_micros += _read_cost;
+    serviceFires();
+    return currentMicros();
+}
+
+void timer_init(void) {
+    if (!_running) {
+        if (!_started) _elapsed_micros = 0;
+        _started = true;
+        _resumed_at = monotonicMicros();
+        _running = true;
+    }
+}
+
+void timer_stop(void) {
+    _elapsed_micros = 0;
+    _running = false;
+    _started = false;
+}
+
+void timer_pause(void) {
+    _elapsed_micros = currentMicros();
+    _running = false;
+}
+
+void timer_resume(void) {
+    if (!_running) {
+        _resumed_at = monotonicMicros();
+        _running = true;
+    }
+}
+
+unsigned int timer_getMillis(void) {
+    return (unsigned int)(readMicros() / 1000);
+}
+
+unsigned int timer_getMicros(void) {
+    return (unsigned int)readMicros();
+}
+
+uint64_t timer_getMicros64(void) {
+    return readMicros();
+}
+
+void timer_waitMicros(unsigned int delay_time) {
+    if (_virtual) {
+        timer_host_advanceMicros(delay_time);
+        return;
+    }
+
+    uint64_t start = monotonicMicros();
+    while (monotonicMicros() - start < delay_time) serviceFires();
+}
+
+void timer_waitMillis(unsigned int delay_time) {
+    while (delay_time > 0) {
+        timer_waitMicros(1000);
+        delay_time--;
+    }
+}
+
+//arms the emulated TIMER4. times is -1 to fire forever
+static void fireSetup(void (*f)(void), uint64_t micros, int times) {
+    _fire_function = f;
+    _fire_interval = micros;
+    _fire_next = currentMicros() + _fire_interval;
+    _fire_remaining = micros > 0 ? times : 0;
+}
+
+void timer_fireEvery(void (*f)(void), int millis) {
+    fireSetup(f, (uint64_t)millis * 1000, -1);
+}
+
+void timer_fireEveryMicros(void (*f)(void), unsigned int micros) {
+    fireSetup(f, micros, -1);
+}
+
+void timer_fireOnce(void (*f)(void), int millis) {
+    fireSetup(f, (uint64_t)millis * 1000, 1);
+}
+
+void timer_fireFor(void (*f)(void), int millis, int times) {
+    if (times > 0) fireSetup(f, (uint64_t)millis * 1000, times);
+}
+
+void timer_fireStop(void) {
+    _fire_remaining = 0;
+    _fire_function = 0;
+}
+
+unsigned int timer_fireCount(void) {
+    readMicros();
+    return _fire_count;
+}
+
+void timer_idle(bool (*idle)(void)) {
+    //with nothing armed there is no interrupt to wake up for
+    if (_fire_remaining == 0 || !idle()) return;
+
+    if (_virtual) {
+        if (_running && _fire_next > _elapsed_micros) _elapsed_micros = _fire_next;
+        serviceFires();
+        return;
+    }
+
+    uint64_t now = currentMicros();
+    if (_fire_next > now) {
+        struct timespec ts;
+        uint64_t delay = _fire_next - now;
+        ts.tv_sec = delay / 1000000ULL;
+        ts.tv_nsec = (delay % 1000000ULL) * 1000ULL;
+        nanosleep(&ts, NULL);
+    }
+    serviceFires();
+}
+
+void timer_host_useVirtualClock(bool virtualClock) {
+    _elapsed_micros = currentMicros();
+    _resumed_at = monotonicMicros();
+    _virtual = virtualClock;
+}
+
+void timer_host_setReadCost(unsigned int micros) {
+    _read_cost = micros;
+}
+
+void timer_host_pend(void (*f)(void)) {
+    _pended = f;
+}
+
+void timer_host_advanceMicros(unsigned int micros) {
+    uint64_t left = micros;
+
+    //stop at every fire on the way, so an interrupt that switches contexts does so when it is due
+    //a context switched out there picks up with whatever is left, as the target's busy-wait would
+    while (_virtual && _running && _fire_remaining != 0 && !_in_fire && _fire_next < _elapsed_micros + left) {
+        uint64_t step = _fire_next > _elapsed_micros ? _fire_next - _elapsed_micros : 0;
+        _elapsed_micros += step;
+        left -= step;
+        serviceFires();
+    }
+
+    if (_virtual && _running) _elapsed_micros += left;
+    serviceFires();
+}
+
+#endif /* SCHED_HOST */
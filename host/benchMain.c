@@ -0,0 +1,39 @@
+/*
+ * benchMain.c
+ *
+ *  Host entry point for the benchmarks in Bench.c. Prints the CSV results on
+ *  stdout, on the virtual clock unless -w is given. Build it in place of
+ *  hostMain.c, with Bench.c added and SCHED_BENCH defined.
+ *
+ *  usage: scheduler_bench [-w]
+ *      -w  use the wall clock instead of the virtual clock
+ */
+
+#ifdef SCHED_HOST
+
+#include <stdio.h>
+#include <string.h>
+#include "Bench.h"
+#include "Timer.h"
+
+static void printLine(const char* line) {
+    puts(line);
+}
+
+int main(int argc, char** argv) {
+    int a;
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "-w")) timer_host_useVirtualClock(false);
+        else {
+            fprintf(stderr, "usage: %s [-w]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sched_init();
+    bench_runAll(printLine);
+
+    return 0;
+}
+
+#endif /* SCHED_HOST */
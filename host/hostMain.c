@@ -0,0 +1,239 @@
+/*
+ * hostMain.c
+ *
+ *  Host counterpart of main.c. Runs the example task set against the Linux
+ *  Timer backend and reports the result on stdout instead of the LCD.
+ *
+ *  usage: scheduler_host [-w] [-c] [-o] [-r] [-s] [-l] [-p] [-d] [-m] [-f] [-a jobs] [-t trace.bin] [-n hyperperiods]
+ *      -w  use the wall clock instead of the virtual clock
+ *      -o  dispatch with the online EDF engine instead of a precomputed table
+ *      -r  dispatch by rate-monotonic fixed priorities
+ *      -s  serve aperiodic jobs from a sporadic server (with -o or -r)
+ *      -l  let aperiodic jobs steal slack from the table
+ *      -d  replace the two slot task with one that admits and retires it at run time
+ *      -m  switch between two operating modes, one with the two slot task and one with a faster one slot task
+ *          (both modes are redefined 1000 times first, which must not grow the schedule run arena)
+ *      -f  give the example tasks release offsets and deadlines shorter than their periods
+ *      -p  run tasks preemptively, with blocking versions of the example tasks (SCHED_PREEMPTIVE builds only)
+ *      -a  post this many one-slot aperiodic jobs before the first run
+ *      -t  record a binary trace to the given file, decode it with trace_decode (SCHED_TRACE builds only)
+ *      -c  continuous mode, run() only returns on exit or error
+ *      -n  number of calls to run() before stopping (default 100)
+ */
+
+#ifdef SCHED_HOST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Timer.h"
+#include "testTasks.h"
+#include "Trace.h"
+
+void handleError(runFlag_t flags) {
+    if (flags & FLAG_YIELD_ERROR) {
+        printf("Task %d did not yield frequently enough\n", (flags & FLAG_TASKINDEX) >> 8);
+    }
+    else if (flags & FLAG_INSUFFICIENT_COMPTIME) {
+        printf("Task %d was not given enough compTime\n", (flags & FLAG_TASKINDEX) >> 8);
+    }
+    else if (flags & FLAG_DEADLINE_MISS) {
+        printf("Task %d missed its deadline\n", (flags & FLAG_TASKINDEX) >> 8);
+    }
+    else if (flags & FLAG_SCHEDULE_ERROR) {
+        printf("Task set could not be scheduled\n");
+    }
+    else if (flags & FLAG_ALLOC_ERROR) {
+        printf("Out of scheduler memory\n");
+    }
+    else if (flags & FLAG_STACK_OVERFLOW) {
+        printf("Task %d overflowed its stack\n", (flags & FLAG_TASKINDEX) >> 8);
+    }
+    else {
+        //catch-all "other" state
+        printf("Unknown error\n");
+    }
+}
+
+#if SCHED_PROFILE
+//one line of the profile table, times in us. index -1 is every aperiodic job together
+static void printStats(int index, const TaskStats* st) {
+    if (index < 0) printf("aper ");
+    else printf("%4d ", index);
+
+    if (!st->calls) {
+        printf("%6u\n", 0u);
+        return;
+    }
+
+    printf("%6lu %4lu %5lu %5lu %5lu %5lu %7lu %8lu\n",
+           (unsigned long)st->calls, (unsigned long)st->callMin,
+           (unsigned long)(st->callTotal / st->calls), (unsigned long)st->callMax,
+           (unsigned long)st->jobs, (unsigned long)st->demandMax,
+           (unsigned long)(st->jobs ? st->startMax - st->startMin : 0), (unsigned long)st->latencyMax);
+}
+#endif
+
+int main(int argc, char** argv) {
+    unsigned long runs = 100;
+    unsigned long jobs = 0;
+#if SCHED_TRACE
+    const char* tracePath = NULL;
+#endif
+    bool continuous = false;
+    bool preemptive = false;
+    bool dynamic = false;
+    bool modes = false;
+    bool phased = false;
+    SchedPolicy policy = POLICY_EDF_TABLE;
+    SchedServer server = SERVER_POLLING;
+    int a;
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "-w")) timer_host_useVirtualClock(false);
+        else if (!strcmp(argv[a], "-c")) continuous = true;
+        else if (!strcmp(argv[a], "-o")) policy = POLICY_EDF_ONLINE;
+        else if (!strcmp(argv[a], "-r")) policy = POLICY_RM;
+        else if (!strcmp(argv[a], "-s")) server = SERVER_SPORADIC;
+        else if (!strcmp(argv[a], "-l")) server = SERVER_SLACK_STEALING;
+        else if (!strcmp(argv[a], "-p")) preemptive = true;
+        else if (!strcmp(argv[a], "-d")) dynamic = true;
+        else if (!strcmp(argv[a], "-m")) modes = true;
+        else if (!strcmp(argv[a], "-f")) phased = true;
+        else if (!strcmp(argv[a], "-a") && a + 1 < argc) jobs = strtoul(argv[++a], NULL, 10);
+#if SCHED_TRACE
+        else if (!strcmp(argv[a], "-t") && a + 1 < argc) tracePath = argv[++a];
+#endif
+        else if (!strcmp(argv[a], "-n") && a + 1 < argc) runs = strtoul(argv[++a], NULL, 10);
+        else {
+            fprintf(stderr, "usage: %s [-w] [-c] [-o] [-r] [-s] [-l] [-p] [-d] [-m] [-f] [-a jobs] [-t trace.bin] [-n hyperperiods]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sched_init();
+#if SCHED_TRACE
+    if (tracePath && !trace_host_open(tracePath)) {
+        perror(tracePath);
+        return 2;
+    }
+#endif
+    SchedParams params;
+    unsigned long n;
+
+    //declare
+    PeriodicTaskSet ts;
+    runFlag_t flags = 0;
+
+    //assemble taskset
+    PeriodicTask testTasks[3];
+
+    //given in microseconds so the set stays the same whatever SCHED_QUANTUM_US it is built with
+    flags |= fillPeriodicTaskMicros(testTasks + 0, aperiodicServer, 1000, 5000);
+    flags |= fillPeriodicTaskMicros(testTasks + 1, preemptive ? oneMilliBlocking : oneMilliTask, 1000, 4000);
+    if (dynamic) flags |= fillPeriodicTaskMicros(testTasks + 2, pipelineSwitch, 1000, 6000);
+    else flags |= fillPeriodicTaskMicros(testTasks + 2, preemptive ? twoMillisBlocking : twoMillisTask, 2000, 6000);
+    ts.size = 3;
+    ts.tasks = testTasks;
+
+    //the one slot task starts a slot late and has to be done within two, the two slot task starts two late
+    if (phased) {
+        flags |= setPeriodicTimingMicros(testTasks + 1, 2000, 1000);
+        flags |= setPeriodicTimingMicros(testTasks + 2, 4000, 2000);
+    }
+
+    //mode 0 is the usual set plus a task that switches modes, mode 1 swaps the two slot task for a one slot task
+    //the mode switching task and oneMilliTask are in both, so they keep their phase across switches
+    PeriodicTask modeTasks[2][4];
+    if (modes) {
+        modeTasks[0][0] = testTasks[0];
+        modeTasks[0][1] = testTasks[1];
+        modeTasks[0][2] = testTasks[2];
+        flags |= fillPeriodicTaskMicros(&(modeTasks[0][3]), modeSwitch, 1000, 12000);
+
+        modeTasks[1][0] = testTasks[0];
+        modeTasks[1][1] = testTasks[1];
+        modeTasks[1][2] = modeTasks[0][3];
+        flags |= fillPeriodicTaskMicros(&(modeTasks[1][3]), oneMilliTask, 1000, 3000);
+
+        ts.tasks = modeTasks[0];
+        ts.size = 4;
+        flags |= sched_defineMode(0, ts);
+
+        ts.tasks = modeTasks[1];
+        flags |= sched_defineMode(1, ts);
+
+        //redefining a mode replaces its table, so doing it over and over must not grow the run arena
+        //the new table is built before the old one is freed, so the first round raises the high water once
+        SchedMemoryReport before, after;
+        for (n = 0; n < 2; n++) {
+            ts.tasks = modeTasks[n];
+            flags |= sched_defineMode(n, ts);
+        }
+        sched_memoryReport(&before);
+        for (n = 0; n < 1000; n++) {
+            ts.tasks = modeTasks[n & 1];
+            flags |= sched_defineMode(n & 1, ts);
+        }
+        sched_memoryReport(&after);
+        if (after.scheduleRuns.used != before.scheduleRuns.used || after.scheduleRuns.highWater != before.scheduleRuns.highWater) {
+            printf("redefining modes grew the schedule runs from %u to %u\n", (unsigned)before.scheduleRuns.highWater,
+                   (unsigned)after.scheduleRuns.highWater);
+            flags |= FLAG_ALLOC_ERROR;
+        }
+
+        ts.tasks = modeTasks[0];
+    }
+
+    //add taskset to params
+    params.tasks = ts;
+    params.policy = policy;
+    params.server = server;
+    params.continuous = continuous;
+    params.preemptive = preemptive;
+
+    for (n = 0; n < jobs; n++) {
+        flags |= addAperiodic(oneMilliTask, 1);
+    }
+
+    for (n = 0; n < runs && !(flags & (FLAG_EXIT | ERROR_FLAGS)); n++) {
+        flags = run(params);
+
+        //what was admitted or retired during the run carries over to the next
+        params.tasks = sched_taskSet();
+    }
+
+#if SCHED_TRACE
+    if (tracePath) trace_host_close();
+#endif
+
+    uint64_t elapsed = timer_getMicros64();
+    printf("%lu hyperperiod(s) in %llu us, flags 0x%04x\n", n, (unsigned long long)elapsed, flags);
+    printf("idle %llu us (%.1f%%)\n", (unsigned long long)sched_idleMicros(),
+           elapsed ? 100.0 * sched_idleMicros() / elapsed : 0.0);
+
+    SchedMemoryReport mem;
+    sched_memoryReport(&mem);
+    printf("pool high water: tasks %u/%u, schedule runs %u/%u\n",
+           (unsigned)mem.tasks.highWater, (unsigned)mem.tasks.capacity,
+           (unsigned)mem.scheduleRuns.highWater, (unsigned)mem.scheduleRuns.capacity);
+    if (preemptive) printf("overruns %lu\n", (unsigned long)sched_overruns());
+    if (modes) printf("ended in mode %d\n", sched_mode());
+    if (dynamic) printf("pipeline switched %lu time(s), %u task(s) at the end\n", (unsigned long)pipelineSwitches(), (unsigned)sched_taskSet().size);
+
+#if SCHED_PROFILE
+    printf("task  calls  min  mean   max  jobs  wcet  jitter  latency\n");
+    for (a = 0; a < ts.size; a++) {
+        printStats(a, &(ts.tasks[a].task->stats));
+    }
+    if (sched_aperiodicStats()->calls) printStats(-1, sched_aperiodicStats());
+#endif
+
+    if (flags & ERROR_FLAGS) {
+        handleError(flags);
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif /* SCHED_HOST */
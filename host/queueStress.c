@@ -0,0 +1,137 @@
+/*
+ * queueStress.c
+ *
+ *  Multi-producer stress test for AperQueue. Four pthreads post jobs as fast
+ *  as they can, standing in for ISRs and tasks on the target, while the main
+ *  thread drains the queue as the aperiodic server would. Every job carries
+ *  its producer and a per-producer sequence number in compTime, so the
+ *  consumer can check that:
+ *
+ *      - no job is lost and none is served twice
+ *      - each producer's jobs come out in the order it posted them
+ *
+ *  All jobs have no deadline and the same priority, so the queue serves them
+ *  in posting order. A failed post means the ring is full and is retried;
+ *  both sides yield while they wait so the test also runs on a single core.
+ *  Build it on its own:
+ *
+ *      gcc -std=gnu99 -O2 -DSCHED_HOST -I. AperQueue.c Profiler.c host/queueStress.c -lpthread -o queue_stress
+ *
+ *  usage: queue_stress [-n jobs per producer]
+ *      -n  jobs each producer posts (default 1000000)
+ */
+
+#ifdef SCHED_HOST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "AperQueue.h"
+
+#define PRODUCERS 4
+#define PRODUCER_SHIFT 28 //compTime holds the producer in its top bits and the sequence number below them
+#define SEQUENCE_MASK ((1UL << PRODUCER_SHIFT) - 1)
+
+static AperQueue queue;
+static uint32_t jobsPerProducer = 1000000;
+static unsigned long fullRetries[PRODUCERS];
+static uint32_t producersDone;
+
+static void dummyJob(taskFuncFlag_t* flags) {
+    *flags |= FLAG_FINISHED;
+}
+
+static void* produce(void* arg) {
+    uint32_t producer = (uint32_t)(uintptr_t)arg;
+    uint32_t n;
+    for (n = 0; n < jobsPerProducer; n++) {
+        while (!aperQueue_post(&queue, dummyJob, (producer << PRODUCER_SHIFT) | n, false, 0, 0, 0)) {
+            fullRetries[producer]++;
+            sched_yield();
+        }
+    }
+    __atomic_add_fetch(&producersDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    int a;
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "-n") && a + 1 < argc) jobsPerProducer = (uint32_t)strtoul(argv[++a], NULL, 10);
+        else {
+            fprintf(stderr, "usage: %s [-n jobs per producer]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (jobsPerProducer == 0 || jobsPerProducer > SEQUENCE_MASK) {
+        fprintf(stderr, "jobs per producer must be between 1 and %lu\n", (unsigned long)SEQUENCE_MASK);
+        return 2;
+    }
+
+    aperQueue_init(&queue);
+
+    pthread_t threads[PRODUCERS];
+    uint32_t p;
+    for (p = 0; p < PRODUCERS; p++) {
+        if (pthread_create(&threads[p], NULL, produce, (void*)(uintptr_t)p)) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    //the next sequence number expected from each producer. anything else is a lost, repeated or reordered job
+    uint32_t expected[PRODUCERS] = { 0 };
+    unsigned long total = 0;
+    unsigned long errors = 0;
+    while (1) {
+        AperJob* job = aperQueue_peek(&queue);
+        if (!job) {
+            //stop once every producer is done and the queue has drained, so a lost job cannot hang the test
+            if (__atomic_load_n(&producersDone, __ATOMIC_ACQUIRE) == PRODUCERS && !aperQueue_peek(&queue)) break;
+            sched_yield(); //let a producer run, the host may have a single core
+            continue;
+        }
+
+        uint32_t producer = job->compTime >> PRODUCER_SHIFT;
+        uint32_t sequence = job->compTime & SEQUENCE_MASK;
+        aperQueue_pop(&queue);
+        total++;
+
+        if (producer >= PRODUCERS) {
+            if (errors++ < 10) printf("job from unknown producer %u\n", (unsigned)producer);
+            continue;
+        }
+        if (sequence != expected[producer]) {
+            if (errors++ < 10) {
+                printf("producer %u: got job %u, expected %u (%s)\n", (unsigned)producer, (unsigned)sequence,
+                       (unsigned)expected[producer], sequence < expected[producer] ? "repeated or reordered" : "lost");
+            }
+            if (sequence < expected[producer]) continue;
+        }
+        expected[producer] = sequence + 1;
+    }
+
+    for (p = 0; p < PRODUCERS; p++) {
+        pthread_join(threads[p], NULL);
+        if (expected[p] != jobsPerProducer) {
+            printf("producer %u: last job served was %u of %u\n", (unsigned)p, (unsigned)expected[p], (unsigned)jobsPerProducer);
+            errors++;
+        }
+    }
+    if (total != (unsigned long)PRODUCERS * jobsPerProducer) {
+        printf("%lu jobs served, %lu posted\n", total, (unsigned long)PRODUCERS * jobsPerProducer);
+        errors++;
+    }
+
+    unsigned long retries = 0;
+    for (p = 0; p < PRODUCERS; p++) retries += fullRetries[p];
+    printf("%d producers, %lu jobs served, queue high water %u/%u, %lu posts retried on a full ring\n", PRODUCERS, total,
+           (unsigned)queue.highWater, (unsigned)SCHED_MAX_APERIODIC, retries);
+    printf("%lu error(s)\n", errors);
+
+    return errors ? 1 : 0;
+}
+
+#endif /* SCHED_HOST */
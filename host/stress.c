@@ -0,0 +1,561 @@
+/*
+ * stress.c
+ *
+ *  Differential stress harness for buildScheduleEDF(). Generates random task
+ *  sets with UUniFast utilizations and periods that divide a hyperperiod under
+ *  the cap, then checks three independent answers against each other:
+ *
+ *      - checkFeasibilityEDF()
+ *      - a slot-by-slot reference EDF simulator written here
+ *      - buildScheduleEDF(), whose table is also replayed to check that every
+ *        job meets its deadline and every slot goes to an earliest-deadline job
+ *
+ *  The scheduler keeps its pools in globals, so the work is spread over forked
+ *  worker processes rather than threads. Each disagreement is printed with its
+ *  task set; the summary ends with build time charted against hyperperiod and
+ *  task count. Build it on its own, with a run arena large enough for the
+ *  biggest tables:
+ *
+ *      gcc -std=gnu99 -O2 -DSCHED_HOST -DSCHED_MAX_SCHEDULE_RUNS=65536 -I. Scheduler.c Utils.c OnlineEDF.c
+ *          Feasibility.c FixedPriority.c Pool.c AperQueue.c SporadicServer.c SlackStealer.c Profiler.c
+ *          Trace.c testTasks.c host/TimerHost.c host/stress.c -lm -o scheduler_stress
+ *
+ *  usage: scheduler_stress [-n sets] [-j workers] [-s seed] [-t max tasks] [-c hyperperiod cap]
+ *                          [-u min util] [-U max util] [-p uniform|log|harmonic] [-m min period] [-d share]
+ *      -n  task sets to generate (default 10000)
+ *      -j  worker processes (default one per online core)
+ *      -s  seed, the same seed always generates the same sets (default 1)
+ *      -t  tasks per set, drawn from 2 up to this (default SCHED_MAX_PERIODIC)
+ *      -c  hyperperiod cap, periods divide the most composite number under it (default SCHED_MAX_HYPERPERIOD)
+ *      -u  -U  total utilization range the sets are drawn from (default 0.5 to 1.05)
+ *      -p  period distribution over the divisors (default log)
+ *      -m  shortest period (default 4)
+ *      -d  share of tasks drawn with a deadline shorter than the period and a release offset (default 0)
+ *          the feasibility test ignores offsets, so it is only held to the simulator for sets without any
+ */
+
+#ifdef SCHED_HOST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Scheduler.h"
+#include "Utils.h"
+#include "Feasibility.h"
+
+#define MAX_DIVISORS 256
+#define MAX_WORKERS 64
+#define HYPERPERIOD_BUCKETS 16 //log2 buckets of the hyperperiod for the chart
+#define CHART_WIDTH 50
+
+typedef enum {
+    PERIODS_UNIFORM = 0, //any divisor equally likely
+    PERIODS_LOG,         //log-uniform between the shortest and longest divisor
+    PERIODS_HARMONIC     //every period divides the next longer one
+} PeriodDistribution;
+
+typedef struct {
+    unsigned long sets;
+    unsigned workers;
+    unsigned long long seed;
+    uint8_t maxTasks;
+    uint32_t cap;
+    double minUtil;
+    double maxUtil;
+    PeriodDistribution distribution;
+    uint32_t minPeriod;
+    double phased;
+} Options;
+
+//what one worker found, sent back to the parent through a pipe
+typedef struct {
+    unsigned long sets;
+    unsigned long feasible; //passed checkFeasibilityEDF()
+    unsigned long simulated; //met every deadline in the reference simulator
+    unsigned long built; //buildScheduleEDF() returned a table
+    unsigned long skipped; //the table did not fit in the run arena, not counted as a disagreement
+    unsigned long disagreements;
+    double buildNanos[HYPERPERIOD_BUCKETS];
+    unsigned long buildCount[HYPERPERIOD_BUCKETS];
+    double buildNanosByTasks[SCHED_MAX_PERIODIC + 1];
+    unsigned long buildCountByTasks[SCHED_MAX_PERIODIC + 1];
+} Results;
+
+typedef struct {
+    uint32_t compTime;
+    uint32_t period;
+    uint32_t deadline;
+    uint32_t offset;
+} GenTask;
+
+static Options options;
+static uint32_t divisors[MAX_DIVISORS];
+static uint32_t divisorCount;
+static uint32_t base; //every period divides this
+
+static uint64_t rngState;
+
+//splitmix64, good enough for test data and trivially seeded
+static uint64_t nextRandom(void) {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//uniform in [0, 1)
+static double randomUnit(void) {
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t randomBelow(uint32_t n) {
+    return (uint32_t)(nextRandom() % n);
+}
+
+//picks the number under the cap with the most divisors, so periods can vary the most without exceeding it
+static void chooseBase(void) {
+    uint32_t best = 1;
+    uint32_t bestCount = 0;
+    uint32_t x;
+    for (x = 1; x <= options.cap; x++) {
+        uint32_t count = 0;
+        uint32_t d;
+        for (d = 1; d * d <= x; d++) {
+            if (x % d == 0) count += d * d == x ? 1 : 2;
+        }
+        if (count >= bestCount) {
+            best = x;
+            bestCount = count;
+        }
+    }
+
+    base = best;
+    divisorCount = 0;
+    for (x = options.minPeriod; x <= base && divisorCount < MAX_DIVISORS; x++) {
+        if (base % x == 0) divisors[divisorCount++] = x;
+    }
+}
+
+static uint32_t pickPeriod(const uint32_t* chain, uint32_t chainLength) {
+    switch (options.distribution) {
+    case PERIODS_UNIFORM:
+        return divisors[randomBelow(divisorCount)];
+    case PERIODS_HARMONIC:
+        return chain[randomBelow(chainLength)];
+    default: {
+        //nearest divisor to a log-uniform target
+        double low = log(divisors[0]);
+        double target = low + randomUnit() * (log(divisors[divisorCount - 1]) - low);
+        uint32_t best = 0;
+        uint32_t d;
+        for (d = 1; d < divisorCount; d++) {
+            if (fabs(log(divisors[d]) - target) < fabs(log(divisors[best]) - target)) best = d;
+        }
+        return divisors[best];
+    }
+    }
+}
+
+//fills tasks with a random set and returns its size. utilizations come from UUniFast,
+//compTime is the rounded share of the period, at least 1 and at most the period
+static uint8_t generate(GenTask* tasks) {
+    uint8_t n = 2 + randomBelow(options.maxTasks - 1);
+    double total = options.minUtil + randomUnit() * (options.maxUtil - options.minUtil);
+
+    //a random chain of periods, each dividing the next, for the harmonic distribution
+    uint32_t chain[32];
+    uint32_t chainLength = 1;
+    chain[0] = divisors[randomBelow(divisorCount < 4 ? divisorCount : 4)];
+    while (chainLength < 32) {
+        static const uint32_t primes[] = { 2, 3, 5, 7 };
+        uint32_t fits[4];
+        uint32_t fitCount = 0;
+        uint32_t p;
+        for (p = 0; p < 4; p++) {
+            if (base % (chain[chainLength - 1] * primes[p]) == 0) fits[fitCount++] = primes[p];
+        }
+        if (!fitCount) break;
+        chain[chainLength] = chain[chainLength - 1] * fits[randomBelow(fitCount)];
+        chainLength++;
+    }
+
+    uint8_t i;
+    for (i = 0; i < n; i++) {
+        double share = total;
+        if (i < n - 1) {
+            double next = total * pow(randomUnit(), 1.0 / (n - 1 - i));
+            share = total - next;
+            total = next;
+        }
+
+        tasks[i].period = pickPeriod(chain, chainLength);
+        tasks[i].deadline = tasks[i].period;
+        tasks[i].offset = 0;
+        uint32_t c = (uint32_t)(share * tasks[i].period + 0.5);
+        tasks[i].compTime = c < 1 ? 1 : c > tasks[i].period ? tasks[i].period : c;
+
+        //no draw at all without -d, so a seed gives the same sets as before the option existed
+        if (options.phased > 0 && randomUnit() < options.phased) {
+            tasks[i].deadline = tasks[i].compTime + randomBelow(tasks[i].period - tasks[i].compTime + 1);
+            tasks[i].offset = randomBelow(tasks[i].period - tasks[i].deadline + 1);
+        }
+    }
+
+    return n;
+}
+
+static uint32_t hyperperiodOf(const GenTask* tasks, uint8_t n) {
+    uint32_t h = 1;
+    uint8_t i;
+    for (i = 0; i < n; i++) h = h / greatestCommonDivisor(h, tasks[i].period) * tasks[i].period;
+    return h;
+}
+
+//reference EDF, one slot at a time with nothing shared with the builder. returns true if no job misses its deadline
+static bool simulate(const GenTask* tasks, uint8_t n, uint32_t hyperperiod) {
+    uint32_t remaining[SCHED_MAX_PERIODIC] = { 0 };
+    uint32_t deadline[SCHED_MAX_PERIODIC] = { 0 };
+    uint32_t t;
+    uint8_t i;
+
+    for (t = 0; t < hyperperiod; t++) {
+        int best = -1;
+        for (i = 0; i < n; i++) {
+            if (remaining[i] && deadline[i] <= t) return false;
+            if (t % tasks[i].period == tasks[i].offset) {
+                remaining[i] = tasks[i].compTime;
+                deadline[i] = t + tasks[i].deadline;
+            }
+            if (remaining[i] && (best < 0 || deadline[i] < deadline[best])) best = i;
+        }
+        if (best >= 0) remaining[best]--;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (remaining[i]) return false;
+    }
+    return true;
+}
+
+//replays a built table. returns NULL if it is valid, otherwise what is wrong with it
+static const char* checkTable(const PeriodicSchedule* s, const GenTask* tasks, uint8_t n, uint32_t hyperperiod) {
+    uint32_t remaining[SCHED_MAX_PERIODIC] = { 0 };
+    uint32_t deadline[SCHED_MAX_PERIODIC] = { 0 };
+    uint32_t t = 0;
+    uint32_t r;
+    uint8_t i;
+
+    if (s->size != hyperperiod) return "table length is not the hyperperiod";
+
+    for (r = 0; r < s->runCount; r++) {
+        uint8_t k;
+        if (s->runs[r].index >= n || s->runs[r].length == 0) return "bad run entry";
+
+        for (k = 0; k < s->runs[r].length; k++, t++) {
+            uint8_t index = s->runs[r].index;
+            bool ready = false;
+
+            if (t >= hyperperiod) return "runs cover more than the hyperperiod";
+            for (i = 0; i < n; i++) {
+                if (remaining[i] && deadline[i] <= t) return "a job misses its deadline";
+                if (t % tasks[i].period == tasks[i].offset) {
+                    remaining[i] = tasks[i].compTime;
+                    deadline[i] = t + tasks[i].deadline;
+                }
+                if (remaining[i]) ready = true;
+            }
+
+            if (!remaining[index]) {
+                if (ready) return "a slot is left idle while a job is ready";
+                continue;
+            }
+            for (i = 0; i < n; i++) {
+                if (remaining[i] && deadline[i] < deadline[index]) return "a slot does not go to the earliest deadline";
+            }
+            remaining[index]--;
+        }
+    }
+
+    if (t != hyperperiod) return "runs cover less than the hyperperiod";
+    for (i = 0; i < n; i++) {
+        if (remaining[i]) return "a job misses its deadline";
+    }
+    return NULL;
+}
+
+static void dummyTask(taskFuncFlag_t* flags) {
+    *flags |= FLAG_FINISHED;
+}
+
+static double nanosSince(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec);
+}
+
+static void report(unsigned long long setSeed, const char* what, const GenTask* tasks, uint8_t n, uint32_t hyperperiod) {
+    char line[1024];
+    int length = snprintf(line, sizeof(line), "seed %llu, hyperperiod %u: %s:", setSeed, (unsigned)hyperperiod, what);
+    uint8_t i;
+    for (i = 0; i < n && length < (int)sizeof(line) - 32; i++) {
+        length += snprintf(line + length, sizeof(line) - length, " %u/%u", (unsigned)tasks[i].compTime, (unsigned)tasks[i].period);
+        if (tasks[i].deadline != tasks[i].period || tasks[i].offset) {
+            length += snprintf(line + length, sizeof(line) - length, "/%u@%u", (unsigned)tasks[i].deadline, (unsigned)tasks[i].offset);
+        }
+    }
+    //one write per line keeps lines from different workers apart
+    line[length++] = '\n';
+    fflush(stdout);
+    write(STDOUT_FILENO, line, length);
+}
+
+//runs one worker's share of the sets. set k of the whole run is always generated from seed + k
+static void work(unsigned worker, Results* results) {
+    unsigned long k;
+    memset(results, 0, sizeof(*results));
+
+    sched_init();
+    for (k = worker; k < options.sets; k += options.workers) {
+        GenTask gen[SCHED_MAX_PERIODIC];
+        PeriodicTask tasks[SCHED_MAX_PERIODIC];
+        PeriodicTaskSet ts;
+        bool phased = false;
+        unsigned long long setSeed = options.seed + k;
+        uint8_t i;
+
+        rngState = setSeed;
+        uint8_t n = generate(gen);
+        uint32_t hyperperiod = hyperperiodOf(gen, n);
+
+        ts.tasks = tasks;
+        ts.size = n;
+        for (i = 0; i < n; i++) {
+            if (fillPeriodicTask(tasks + i, dummyTask, gen[i].compTime, gen[i].period)) {
+                fprintf(stderr, "out of Task structs, raise SCHED_MAX_TASKS\n");
+                exit(1);
+            }
+            setPeriodicTiming(tasks + i, gen[i].deadline, gen[i].offset);
+            if (gen[i].offset) phased = true;
+        }
+
+        bool feasible = checkFeasibilityEDF(ts, NULL);
+        bool simulated = simulate(gen, n, hyperperiod);
+
+        runFlag_t error;
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        PeriodicSchedule* schedule = getSchedule(ts, &error);
+        double nanos = nanosSince(&start);
+
+        results->sets++;
+        if (feasible) results->feasible++;
+        if (simulated) results->simulated++;
+
+        //a set that needs its offsets is feasible without passing the synchronous test
+        if (feasible != simulated && !(phased && simulated)) {
+            report(setSeed, simulated ? "feasibility test rejects a schedulable set" : "feasibility test accepts an unschedulable set",
+                   gen, n, hyperperiod);
+            results->disagreements++;
+        }
+
+        if (!schedule && (error & FLAG_ALLOC_ERROR)) {
+            results->skipped++;
+        }
+        else if (!schedule) {
+            if (simulated) {
+                report(setSeed, "builder rejects a schedulable set", gen, n, hyperperiod);
+                results->disagreements++;
+            }
+        }
+        else {
+            const char* problem = checkTable(schedule, gen, n, hyperperiod);
+            results->built++;
+            if (!simulated) {
+                report(setSeed, "builder accepts an unschedulable set", gen, n, hyperperiod);
+                results->disagreements++;
+            }
+            else if (problem) {
+                report(setSeed, problem, gen, n, hyperperiod);
+                results->disagreements++;
+            }
+
+            uint32_t bucket = 0;
+            while (bucket < HYPERPERIOD_BUCKETS - 1 && (2u << bucket) <= hyperperiod) bucket++;
+            results->buildNanos[bucket] += nanos;
+            results->buildCount[bucket]++;
+            results->buildNanosByTasks[n] += nanos;
+            results->buildCountByTasks[n]++;
+        }
+
+        invalidateSchedule();
+        freePeriodicTaskSet(&ts);
+    }
+}
+
+static void merge(Results* into, const Results* from) {
+    uint32_t i;
+    into->sets += from->sets;
+    into->feasible += from->feasible;
+    into->simulated += from->simulated;
+    into->built += from->built;
+    into->skipped += from->skipped;
+    into->disagreements += from->disagreements;
+    for (i = 0; i < HYPERPERIOD_BUCKETS; i++) {
+        into->buildNanos[i] += from->buildNanos[i];
+        into->buildCount[i] += from->buildCount[i];
+    }
+    for (i = 0; i <= SCHED_MAX_PERIODIC; i++) {
+        into->buildNanosByTasks[i] += from->buildNanosByTasks[i];
+        into->buildCountByTasks[i] += from->buildCountByTasks[i];
+    }
+}
+
+//one bar per row, scaled to the slowest row
+static void chart(const char* title, const char* const* labels, const double* nanos, const unsigned long* counts, uint32_t rows) {
+    double longest = 0;
+    uint32_t i;
+    for (i = 0; i < rows; i++) {
+        if (counts[i] && nanos[i] / counts[i] > longest) longest = nanos[i] / counts[i];
+    }
+    if (longest == 0) return;
+
+    printf("\n%s\n", title);
+    for (i = 0; i < rows; i++) {
+        if (!counts[i]) continue;
+        double mean = nanos[i] / counts[i];
+        int bar = (int)(mean / longest * CHART_WIDTH + 0.5);
+        printf("%-12s %9.1f us %6lu sets |", labels[i], mean / 1000.0, counts[i]);
+        while (bar-- > 0) putchar('#');
+        putchar('\n');
+    }
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [-n sets] [-j workers] [-s seed] [-t max tasks] [-c hyperperiod cap]\n"
+                    "          [-u min util] [-U max util] [-p uniform|log|harmonic] [-m min period] [-d share]\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    int a;
+
+    options.sets = 10000;
+    options.workers = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+    options.seed = 1;
+    options.maxTasks = SCHED_MAX_PERIODIC;
+    options.cap = SCHED_MAX_HYPERPERIOD;
+    options.minUtil = 0.5;
+    options.maxUtil = 1.05;
+    options.distribution = PERIODS_LOG;
+    options.minPeriod = 4;
+    options.phased = 0;
+
+    for (a = 1; a < argc; a++) {
+        if (a + 1 >= argc) usage(argv[0]);
+        else if (!strcmp(argv[a], "-n")) options.sets = strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-j")) options.workers = (unsigned)strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-s")) options.seed = strtoull(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-t")) options.maxTasks = (uint8_t)strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-c")) options.cap = (uint32_t)strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-u")) options.minUtil = atof(argv[++a]);
+        else if (!strcmp(argv[a], "-U")) options.maxUtil = atof(argv[++a]);
+        else if (!strcmp(argv[a], "-m")) options.minPeriod = (uint32_t)strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-d")) options.phased = atof(argv[++a]);
+        else if (!strcmp(argv[a], "-p")) {
+            a++;
+            if (!strcmp(argv[a], "uniform")) options.distribution = PERIODS_UNIFORM;
+            else if (!strcmp(argv[a], "log")) options.distribution = PERIODS_LOG;
+            else if (!strcmp(argv[a], "harmonic")) options.distribution = PERIODS_HARMONIC;
+            else usage(argv[0]);
+        }
+        else usage(argv[0]);
+    }
+
+    if (options.workers < 1) options.workers = 1;
+    if (options.workers > MAX_WORKERS) options.workers = MAX_WORKERS;
+    if (options.maxTasks < 2 || options.maxTasks > SCHED_MAX_PERIODIC || options.minUtil <= 0 ||
+        options.maxUtil < options.minUtil || options.minPeriod < 1) usage(argv[0]);
+    if (options.cap > SCHED_MAX_HYPERPERIOD) {
+        fprintf(stderr, "the cap is above SCHED_MAX_HYPERPERIOD (%u), the builder would reject those sets\n", SCHED_MAX_HYPERPERIOD);
+        return 2;
+    }
+
+    chooseBase();
+    if (divisorCount == 0) {
+        fprintf(stderr, "no period of at least %u divides %u\n", (unsigned)options.minPeriod, (unsigned)base);
+        return 2;
+    }
+    printf("%lu sets over %u workers, periods divide %u\n", options.sets, options.workers, (unsigned)base);
+
+    int pipes[MAX_WORKERS];
+    pid_t pids[MAX_WORKERS];
+    unsigned w;
+    for (w = 0; w < options.workers; w++) {
+        int fds[2];
+        if (pipe(fds)) {
+            perror("pipe");
+            return 1;
+        }
+
+        fflush(stdout);
+        pids[w] = fork();
+        if (pids[w] < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pids[w] == 0) {
+            Results results;
+            close(fds[0]);
+            work(w, &results);
+            write(fds[1], &results, sizeof(results));
+            _exit(0);
+        }
+        close(fds[1]);
+        pipes[w] = fds[0];
+    }
+
+    Results total;
+    memset(&total, 0, sizeof(total));
+    bool failed = false;
+    for (w = 0; w < options.workers; w++) {
+        Results results;
+        int status;
+        if (read(pipes[w], &results, sizeof(results)) == sizeof(results)) merge(&total, &results);
+        else failed = true;
+        close(pipes[w]);
+        waitpid(pids[w], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) failed = true;
+    }
+
+    printf("%lu sets: %lu feasible, %lu schedulable in the reference, %lu built, %lu too large for the run arena\n",
+           total.sets, total.feasible, total.simulated, total.built, total.skipped);
+    printf("%lu disagreement(s)\n", total.disagreements);
+
+    static char bucketLabels[HYPERPERIOD_BUCKETS][16];
+    static char taskLabels[SCHED_MAX_PERIODIC + 1][16];
+    const char* hyperperiodRows[HYPERPERIOD_BUCKETS];
+    const char* taskRows[SCHED_MAX_PERIODIC + 1];
+    uint32_t i;
+    for (i = 0; i < HYPERPERIOD_BUCKETS; i++) {
+        sprintf(bucketLabels[i], "H < %u", 2u << i);
+        hyperperiodRows[i] = bucketLabels[i];
+    }
+    for (i = 0; i <= SCHED_MAX_PERIODIC; i++) {
+        sprintf(taskLabels[i], "%u tasks", (unsigned)i);
+        taskRows[i] = taskLabels[i];
+    }
+    chart("mean build time by hyperperiod", hyperperiodRows, total.buildNanos, total.buildCount, HYPERPERIOD_BUCKETS);
+    chart("mean build time by task count", taskRows, total.buildNanosByTasks, total.buildCountByTasks, SCHED_MAX_PERIODIC + 1);
+
+    if (failed) {
+        fprintf(stderr, "a worker failed\n");
+        return 1;
+    }
+    return total.disagreements ? 1 : 0;
+}
+
+#endif /* SCHED_HOST */
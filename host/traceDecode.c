@@ -0,0 +1,299 @@
+/*
+ * traceDecode.c
+ *
+ *  Turns a binary trace stream recorded by Trace.c into Chrome trace_event
+ *  JSON (open it in chrome://tracing or Perfetto) and a text Gantt chart with
+ *  one column per slot. Build it on its own, it has its own main():
+ *
+ *      gcc -std=gnu99 -O2 -DSCHED_HOST -I. host/traceDecode.c -o trace_decode
+ *
+ *  usage: trace_decode [-j out.json] [-w columns] [-g] trace.bin
+ *      -j  write Chrome trace_event JSON to the given file
+ *      -w  Gantt chart width in slots before wrapping (default 100)
+ *      -g  skip the Gantt chart
+ */
+
+#ifdef SCHED_HOST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Trace.h"
+
+#define MAX_TASKS 256
+#define APERIODIC_TID 1000 //Chrome thread for aperiodic jobs
+#define IDLE_TID 1001 //Chrome thread for sleep
+
+typedef struct {
+    uint64_t time; //absolute microseconds
+    uint8_t type;
+    uint8_t arg;
+} Event;
+
+static Event* events = NULL;
+static size_t eventCount = 0;
+
+static const char* typeNames[] = {
+    "sync", "slot", "yield", "finish", "overrun", "deadline miss",
+    "aperiodic post", "aperiodic start", "aperiodic done", "idle", "lost"
+};
+
+//reads the whole stream. a record cut off at the end is dropped
+static bool readStream(FILE* in) {
+    size_t capacity = 1024;
+    uint64_t now = 0;
+    bool synced = false;
+    int c;
+
+    events = malloc(capacity * sizeof(Event));
+    if (!events) return false;
+
+    while ((c = fgetc(in)) != EOF) {
+        int arg = fgetc(in);
+        uint64_t value = 0;
+        int shift = 0;
+        int byte;
+
+        if (arg == EOF) break;
+        do {
+            byte = fgetc(in);
+            if (byte == EOF) return true;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        if (c == TRACE_SYNC) {
+            if (arg != TRACE_VERSION) {
+                fprintf(stderr, "unsupported trace version %d\n", arg);
+                return false;
+            }
+            //a sync carries the absolute 32-bit time. if streams were joined, keep time moving forward
+            uint64_t synced_time = (now & ~0xFFFFFFFFULL) + value;
+            if (synced && synced_time < now) synced_time += 0x100000000ULL;
+            now = synced_time;
+            synced = true;
+        }
+        else if (!synced) {
+            fprintf(stderr, "stream does not start with a sync record\n");
+            return false;
+        }
+        else {
+            now += value;
+        }
+
+        if (eventCount == capacity) {
+            capacity *= 2;
+            Event* grown = realloc(events, capacity * sizeof(Event));
+            if (!grown) return false;
+            events = grown;
+        }
+        events[eventCount].time = now;
+        events[eventCount].type = (uint8_t)c;
+        events[eventCount].arg = (uint8_t)arg;
+        eventCount++;
+    }
+
+    return true;
+}
+
+static const char* typeName(uint8_t type) {
+    return type < sizeof(typeNames) / sizeof(typeNames[0]) ? typeNames[type] : "unknown";
+}
+
+static void writeChrome(FILE* out) {
+    bool seen[MAX_TASKS] = { false };
+    uint64_t aperiodicStart = 0;
+    bool first = true;
+    size_t i;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+#define SEPARATOR() do { if (!first) fprintf(out, ",\n"); first = false; } while (0)
+
+    for (i = 0; i < eventCount; i++) {
+        Event* e = &(events[i]);
+        uint64_t end = i + 1 < eventCount ? events[i + 1].time : e->time;
+
+        switch (e->type) {
+        case TRACE_SLOT: {
+            //a slot lasts until the next one starts
+            size_t j = i + 1;
+            while (j < eventCount && events[j].type != TRACE_SLOT) j++;
+            end = j < eventCount ? events[j].time : events[eventCount - 1].time;
+
+            SEPARATOR();
+            fprintf(out, "{\"name\":\"task %u\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+                    e->arg, e->arg, (unsigned long long)e->time, (unsigned long long)(end - e->time));
+            seen[e->arg] = true;
+            break;
+        }
+        case TRACE_IDLE:
+            SEPARATOR();
+            fprintf(out, "{\"name\":\"idle\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%llu,\"dur\":%llu}",
+                    IDLE_TID, (unsigned long long)e->time, (unsigned long long)(end - e->time));
+            break;
+        case TRACE_APER_START:
+            aperiodicStart = e->time;
+            break;
+        case TRACE_APER_DONE:
+            SEPARATOR();
+            fprintf(out, "{\"name\":\"aperiodic job\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%llu,\"dur\":%llu}",
+                    APERIODIC_TID, (unsigned long long)aperiodicStart, (unsigned long long)(e->time - aperiodicStart));
+            break;
+        case TRACE_APER_POST:
+            SEPARATOR();
+            fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%llu,\"args\":{\"queued\":%u}}",
+                    typeName(e->type), APERIODIC_TID, (unsigned long long)e->time, e->arg);
+            break;
+        case TRACE_SYNC:
+            break;
+        case TRACE_LOST:
+            SEPARATOR();
+            fprintf(out, "{\"name\":\"lost\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%llu,\"args\":{\"events\":%u}}",
+                    (unsigned long long)e->time, e->arg);
+            break;
+        default:
+            //yield, finish, overrun and deadline miss mark an instant on the task's own row
+            SEPARATOR();
+            fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%llu}",
+                    typeName(e->type), e->arg, (unsigned long long)e->time);
+            break;
+        }
+    }
+
+    for (i = 0; i < MAX_TASKS; i++) {
+        if (!seen[i]) continue;
+        SEPARATOR();
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"task %u\"}}",
+                (unsigned)i, (unsigned)i);
+    }
+    SEPARATOR();
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"aperiodic\"}}", APERIODIC_TID);
+    SEPARATOR();
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"idle\"}}", IDLE_TID);
+
+#undef SEPARATOR
+
+    fprintf(out, "\n]}\n");
+}
+
+//one character per slot and task:
+//  # ran   i ran and went idle   a ran an aperiodic job   X overran or missed a deadline
+static void writeGantt(FILE* out, size_t width) {
+    size_t slots = 0;
+    int maxTask = -1;
+    size_t i;
+
+    for (i = 0; i < eventCount; i++) {
+        if (events[i].type == TRACE_SLOT) slots++;
+        if (events[i].type != TRACE_SYNC && events[i].type != TRACE_LOST && events[i].type != TRACE_APER_POST &&
+            events[i].arg > maxTask) maxTask = events[i].arg;
+    }
+    if (!slots) {
+        fprintf(out, "no slots in trace\n");
+        return;
+    }
+
+    char* chart = malloc(slots * (maxTask + 1));
+    if (!chart) return;
+    memset(chart, ' ', slots * (maxTask + 1));
+
+    size_t slot = 0;
+    int task = -1;
+    bool inAperiodic = false;
+    for (i = 0; i < eventCount; i++) {
+        Event* e = &(events[i]);
+        char* cell = task >= 0 ? &(chart[(size_t)task * slots + slot - 1]) : NULL;
+
+        switch (e->type) {
+        case TRACE_SLOT:
+            slot++;
+            task = e->arg;
+            chart[(size_t)task * slots + slot - 1] = inAperiodic && task == 0 ? 'a' : '#';
+            break;
+        case TRACE_IDLE:
+            if (cell && *cell == '#') *cell = 'i';
+            break;
+        case TRACE_APER_START:
+            inAperiodic = true;
+            if (cell) *cell = 'a';
+            break;
+        case TRACE_APER_DONE:
+            inAperiodic = false;
+            break;
+        case TRACE_OVERRUN:
+        case TRACE_MISS:
+            if (slot) chart[(size_t)e->arg * slots + slot - 1] = 'X';
+            break;
+        }
+    }
+
+    uint64_t start = events[0].time;
+    fprintf(out, "%zu slots over %llu us\n", slots, (unsigned long long)(events[eventCount - 1].time - start));
+
+    size_t from;
+    for (from = 0; from < slots; from += width) {
+        size_t to = from + width < slots ? from + width : slots;
+        size_t s;
+        int t;
+
+        fprintf(out, "\nslot    ");
+        for (s = from; s < to; s++) fputc(s % 10 == 0 ? '|' : ' ', out);
+        fprintf(out, "  %zu\n", from);
+
+        for (t = 0; t <= maxTask; t++) {
+            fprintf(out, "task %-3d", t);
+            fwrite(&(chart[(size_t)t * slots + from]), 1, to - from, out);
+            fputc('\n', out);
+        }
+    }
+
+    free(chart);
+}
+
+int main(int argc, char** argv) {
+    const char* jsonPath = NULL;
+    const char* tracePath = NULL;
+    size_t width = 100;
+    bool gantt = true;
+    bool usage = false;
+    int a;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "-j") && a + 1 < argc) jsonPath = argv[++a];
+        else if (!strcmp(argv[a], "-w") && a + 1 < argc) width = strtoul(argv[++a], NULL, 10);
+        else if (!strcmp(argv[a], "-g")) gantt = false;
+        else if (argv[a][0] != '-' && !tracePath) tracePath = argv[a];
+        else usage = true;
+    }
+    if (usage || !tracePath || !width) {
+        fprintf(stderr, "usage: %s [-j out.json] [-w columns] [-g] trace.bin\n", argv[0]);
+        return 2;
+    }
+
+    FILE* in = fopen(tracePath, "rb");
+    if (!in) {
+        perror(tracePath);
+        return 1;
+    }
+    bool ok = readStream(in);
+    fclose(in);
+    if (!ok) return 1;
+
+    if (jsonPath) {
+        FILE* out = fopen(jsonPath, "w");
+        if (!out) {
+            perror(jsonPath);
+            return 1;
+        }
+        writeChrome(out);
+        fclose(out);
+    }
+
+    if (gantt) writeGantt(stdout, width);
+
+    free(events);
+    return 0;
+}
+
+#endif /* SCHED_HOST */
@@ -1,7 +1,24 @@
 #include <stdio.h>
 #include "lcd.h" //NOTE: LCD code is from CPRE 288 and was not developed by me
 #include "testTasks.h"
-#include <stdlib.h>
+
+#ifdef SCHED_BENCH
+#include "Bench.h"
+#include "Trace.h"
+#include "Timer.h"
+
+//benchmark results go out over UART0, one CSV line each
+static void uartLine(const char* line) {
+    while (*line) {
+        while (UART0_FR_R & UART_FR_TXFF) { }
+        UART0_DR_R = *line++;
+    }
+    while (UART0_FR_R & UART_FR_TXFF) { }
+    UART0_DR_R = '\r';
+    while (UART0_FR_R & UART_FR_TXFF) { }
+    UART0_DR_R = '\n';
+}
+#endif
 
 /**
  * main.c
@@ -15,6 +32,18 @@ void handleError(runFlag_t flags) {
     else if (flags & FLAG_INSUFFICIENT_COMPTIME) {
         sprintf(error_string, "Task %d was not given enough compTime", (flags & FLAG_TASKINDEX) >> 8);
     }
+    else if (flags & FLAG_DEADLINE_MISS) {
+        sprintf(error_string, "Task %d missed its deadline", (flags & FLAG_TASKINDEX) >> 8);
+    }
+    else if (flags & FLAG_SCHEDULE_ERROR) {
+        sprintf(error_string, "Task set could not be scheduled");
+    }
+    else if (flags & FLAG_ALLOC_ERROR) {
+        sprintf(error_string, "Out of scheduler memory");
+    }
+    else if (flags & FLAG_STACK_OVERFLOW) {
+        sprintf(error_string, "Task %d overflowed its stack", (flags & FLAG_TASKINDEX) >> 8);
+    }
     else {
         //catch-all "other" state
         sprintf(error_string, "Unknown error\n");
@@ -27,6 +56,13 @@ int main(void)
 {
     sched_init();
     lcd_init();
+
+#ifdef SCHED_BENCH
+    //define SCHED_BENCH to run the benchmarks instead of the example task set
+    trace_uartInit();
+    bench_runAll(uartLine);
+    lcd_puts("Benchmarks done");
+#else
     SchedParams params;
 
     //declare
@@ -34,17 +70,21 @@ int main(void)
     runFlag_t flags = 0;
 
     //assemble taskset
-    PeriodicTask* testTasks = (PeriodicTask*)malloc(sizeof(PeriodicTask) * 3);
+    static PeriodicTask testTasks[3]; //the heap is not used, see --heap_size=0 in tm4c123gh6pm.cmd
 
-    fillPeriodicTask(testTasks + 0, aperiodicServer, 1, 5);
-    fillPeriodicTask(testTasks + 1, oneMilliTask, 1, 4);
-    fillPeriodicTask(testTasks + 2, twoMillisTask, 2, 6);
+    flags |= fillPeriodicTask(testTasks + 0, aperiodicServer, 1, 5);
+    flags |= fillPeriodicTask(testTasks + 1, oneMilliTask, 1, 4);
+    flags |= fillPeriodicTask(testTasks + 2, twoMillisTask, 2, 6);
     ts.size = 3;
     ts.tasks = testTasks;
     //remember to make the aperiodic server index 0
 
     //add taskset to params
     params.tasks = ts;
+    params.policy = POLICY_EDF_TABLE;
+    params.server = SERVER_POLLING;
+    params.continuous = true; //keep dispatching across hyperperiods without returning
+    params.preemptive = false;
 
     //run in loop while FLAG_EXIT is not set
     while(!(flags & (FLAG_EXIT | ERROR_FLAGS))) {
@@ -54,6 +94,7 @@ int main(void)
     if (flags & ERROR_FLAGS) {
         handleError(flags);
     }
+#endif
 
 	return 0;
 }
@@ -1,6 +1,13 @@
 #include "testTasks.h"
 #include "Timer.h"
+#include "Coroutine.h"
+
+#ifndef SCHED_HOST
 #include "lcd.h"
+#else
+#include <stdio.h>
+#define lcd_puts(s) puts(s) //no LCD on the host, print to stdout instead
+#endif
 
 //example of a bad task function designed not to yield frequently enough
 void yieldError(taskFuncFlag_t* flags) {
@@ -8,16 +15,30 @@ void yieldError(taskFuncFlag_t* flags) {
 }
 
 //example of a task function that requires 2ms of compTime and will not finish if given less
-uint8_t i = 0;
+//a coroutine, so it works one millisecond per call and picks up where it left off
 void twoMillisTask(taskFuncFlag_t* flags) {
-    if (*flags & FLAG_RESET) i = 0;
+    CO_LOCALS(work, struct { uint8_t millis; });
+    CO_BEGIN(flags);
 
-    for (; i < 2; i++) {
+    for (work->millis = 1; work->millis < 2; work->millis++) {
         timer_waitMillis(1); //delay
-
-        if (i == 1) *flags |= FLAG_FINISHED; //finished case
-        break;
+        CO_YIELD();
     }
+    timer_waitMillis(1); //the last millisecond finishes the job in the same call
+
+    CO_END();
+}
+
+//the same jobs written for a preemptive run, where a task may block straight through the slot tick
+//the tick takes the CPU away when compTime runs out, so each job leaves a little of it for dispatch overhead
+void oneMilliBlocking(taskFuncFlag_t* flags) {
+    timer_waitMicros(950);
+    *flags |= FLAG_FINISHED;
+}
+
+void twoMillisBlocking(taskFuncFlag_t* flags) {
+    timer_waitMicros(1950);
+    *flags |= FLAG_FINISHED;
 }
 
 //example of a task that takes only a single millisecond timeslot
@@ -26,6 +47,45 @@ void oneMilliTask(taskFuncFlag_t* flags) {
     *flags |= FLAG_FINISHED;
 }
 
+//example of a task that turns a sensor pipeline, here twoMillisTask, on and off at run time
+//every tenth of its jobs asks for the pipeline to be admitted or retired, the scheduler may refuse
+static PeriodicTask pipeline;
+static uint32_t switches = 0;
+void pipelineSwitch(taskFuncFlag_t* flags) {
+    static uint8_t jobs = 0;
+    static bool on = false;
+
+    if ((*flags & FLAG_RESET) && ++jobs == 10) {
+        jobs = 0;
+        if (!pipeline.task) fillPeriodicTaskMicros(&pipeline, twoMillisTask, 2000, 6000);
+
+        runFlag_t result = on ? retirePeriodic(pipeline.task) : admitPeriodic(&pipeline);
+        if (!result) {
+            on = !on;
+            switches++;
+        }
+    }
+
+    *flags |= FLAG_FINISHED;
+}
+
+//number of times pipelineSwitch() has had its request accepted
+uint32_t pipelineSwitches(void) {
+    return switches;
+}
+
+//example of a task that flips the scheduler between operating modes 0 and 1 every tenth of its jobs
+void modeSwitch(taskFuncFlag_t* flags) {
+    static uint8_t jobs = 0;
+
+    if ((*flags & FLAG_RESET) && ++jobs == 10) {
+        jobs = 0;
+        requestMode(sched_mode() == 1 ? 0 : 1);
+    }
+
+    *flags |= FLAG_FINISHED;
+}
+
 //example of a terminal task
 void exitTask(taskFuncFlag_t* flags) {
     lcd_puts("Terminal task ran");
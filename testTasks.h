@@ -2,5 +2,10 @@
 
 void yieldError(taskFuncFlag_t* flags);
 void twoMillisTask(taskFuncFlag_t* flags);
+void oneMilliBlocking(taskFuncFlag_t* flags);
+void twoMillisBlocking(taskFuncFlag_t* flags);
 void oneMilliTask(taskFuncFlag_t* flags);
 void exitTask(taskFuncFlag_t* flags);
+void pipelineSwitch(taskFuncFlag_t* flags);
+uint32_t pipelineSwitches(void);
+void modeSwitch(taskFuncFlag_t* flags);